@@ -47,11 +47,32 @@ static const char *colors[][3]      = {
     /*                       fg         bg         border  */
     [SchemeNorm] =         { "#ababab", "#222222", "#222222" },
     [SchemeSel]  =         { "#eeeeee", "#222222", "#ff4545" },
+    [SchemeHung] =         { "#ababab", "#4a1c1c", "#4a1c1c" }, /* tabs of clients not answering _NET_WM_PING */
 };
 
 /* Window */
 static const float mfact     = 0.56; /* Factor of master area size [0.05..0.95] */
 static const int nmaster     = 1;    /* Number of clients in master area */
+static const int lazyoccluded = 1;   /* 1 means covered monocle/deck clients are configured once they come to front */
+static const int iconifyhidden = 0;  /* 1 means windows on hidden tags are unmapped (iconic) so they stop rendering */
+static const unsigned int freezedelay = 30; /* seconds a Freeze client sits on a hidden tag before its process is stopped */
+static const unsigned int outlinesize = 1280 * 720; /* windows with more pixels are moved/resized as an outline, 0 never */
+static const unsigned int syncwait = 100;   /* ms a resized client may take to redraw before it gets the next size anyway */
+static const unsigned int cfgrate = 60;    /* ConfigureRequests applied per second and client, more are merged, 0 no limit */
+static const unsigned int cfgburst = 10;   /* ConfigureRequests a client may send at once before cfgrate applies */
+static const unsigned int pingtimeout = 5; /* seconds a client has to answer _NET_WM_PING, 0 disables pinging */
+static const unsigned int focusdwell = 50;  /* ms the pointer must rest in a window before it takes focus, 0 focuses at once */
+
+/* Scheduling */
+static const int schedhints          = 0;   /* 1 means the focused client's processes get CPU priority over the others */
+static const unsigned int schedhold  = 300; /* ms focus must stay put before priorities are changed */
+static const int fgweight            = 400; /* cgroup cpu.weight of the focused client, 100 is the kernel default */
+static const int bgweight            = 50;  /* cgroup cpu.weight of the other clients */
+static const int bgnice              = 5;   /* nice value of the other clients when their cgroup is shared */
+static const unsigned int wakeupstats = 0;  /* seconds between wakeups-per-second reports on stderr, 0 disables */
+
+/* Bars */
+static const int shmbars             = 1;   /* 1 means bars are rasterised client-side and put through MIT-SHM, Xft is used on remote displays */
 
 /* TAGS */
 static const char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9", 
@@ -66,9 +87,9 @@ static const char *const autostart[] = {
 
 /* Window Rules */
 static const Rule rules[] = {
-    /* Class            Instance  Title            Tags Mask  IsFloating  IsTerminal  NoSwallow  Monitor */
-    { "Alacritty",      NULL,     NULL,            0,         0,          1,           0,        -1 },
-    { NULL,             NULL,     "Event Tester",  0,         0,          0,           1,        -1 },
+    /* Class            Instance  Title            Tags Mask  IsFloating  IsTerminal  NoSwallow  Iconify  Freeze  Outline  Monitor */
+    { "Alacritty",      NULL,     NULL,            0,         0,          1,           0,         0,       0,      0,       -1 },
+    { NULL,             NULL,     "Event Tester",  0,         0,          0,           1,         0,       0,      0,       -1 },
 };
 
 /* Window Layouts */
@@ -150,6 +171,7 @@ static Key keys[] = {
 
     /* Toggle Bar */
     { SUPER,                    XK_b,       togglebar,      { 0 } },
+    { SUPER|SHIFT,              XK_b,       togglebarshm,   { 0 } },
 
     /* Toggle Gaps */
     { SUPER,                    XK_g,       togglegaps,     { 0 } },
@@ -41,17 +41,28 @@ DEALINGS IN THE SOFTWARE.
 
 
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <X11/Xft/Xft.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/shm.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
 
 #include "drw.h"
 #include "util.h"
 
 #define UTF_INVALID 0xFFFD
 #define UTF_SIZ     4
+#define GLYPHS      4096 /* glyph cache slots, a power of two */
+#define GLYPHPROBE  8
 
 static const unsigned char utfbyte[UTF_SIZ + 1] = {0x80,    0,  0xC0,   0xE0,     0xF0};
 static const unsigned char utfmask[UTF_SIZ + 1] = {0xC0,  0x80, 0xE0,   0xF0,     0xF8};
@@ -60,6 +71,19 @@ static const long utfmax[UTF_SIZ + 1] = {0x10FFFF, 0x7F, 0x7FF, 0xFFFF, 0x10FFFF
 
 
 
+static DrwOp *dl_push(Drw *drw, int type, int x, int y, unsigned int w,
+                      unsigned int h, unsigned long pixel);
+static void dl_fill(Drw *drw, unsigned long pixel, int x, int y,
+                    unsigned int w, unsigned int h);
+static void dl_text(Drw *drw, Clr *color, XftFont *font, int x, int y, unsigned int w,
+                    unsigned int h, int ty, const char *text, size_t len);
+static void dl_submit(Drw *drw);
+static void dl_raster(Drw *drw);
+static int shm_create(Drw *drw, unsigned int w, unsigned int h);
+static void shm_release(Drw *drw);
+
+
+
 static long utf8decodebyte(const char c, size_t *i) {
     for (*i = 0; *i < (UTF_SIZ + 1); ++(*i)) {
         if (((unsigned char)c & utfmask[*i]) == utfbyte[*i]) {
@@ -108,6 +132,178 @@ static size_t utf8decode(const char *c, long *u, size_t clen) {
 }
 
 
+/* Append an operation painting the given area. The list is submitted as
+ * copies, then fills by color, then text by color, so an operation that would
+ * come out below an earlier one it overlaps first submits what was recorded.
+ * pixel is the fill color, or the text color for text. */
+static DrwOp *dl_push(Drw *drw, int type, int x, int y, unsigned int w,
+                      unsigned int h, unsigned long pixel) {
+
+    DrwOp *op;
+    size_t i;
+
+    for (i = 0; i < drw -> nops; i++) {
+        op = &drw -> ops[i];
+
+        if (type > op -> type || (type == op -> type && (type == DrwCopy || op -> pixel == pixel))) {
+            continue;
+        }
+
+        if (x < op -> x + (int)op -> w && op -> x < x + (int)w &&
+            y < op -> y + (int)op -> h && op -> y < y + (int)h) {
+
+            dl_submit(drw);
+            break;
+        }
+    }
+
+    if (drw -> nops == drw -> opsize) {
+        drw -> opsize = drw -> opsize ? drw -> opsize * 2 : 64;
+        drw -> ops = erealloc(drw -> ops, drw -> opsize * sizeof(DrwOp));
+    }
+
+    op = &drw -> ops[drw -> nops++];
+    memset(op, 0, sizeof(DrwOp));
+    op -> type = type;
+    op -> x = x;
+    op -> y = y;
+    op -> w = w;
+    op -> h = h;
+    op -> pixel = pixel;
+    drw -> frameops++;
+
+    return op;
+}
+
+
+static void dl_fill(Drw *drw, unsigned long pixel, int x, int y,
+                    unsigned int w, unsigned int h) {
+
+    dl_push(drw, DrwFill, x, y, w, h, pixel);
+}
+
+
+static void dl_text(Drw *drw, Clr *color, XftFont *font, int x, int y, unsigned int w,
+                    unsigned int h, int ty, const char *text, size_t len) {
+
+    DrwOp *op = dl_push(drw, DrwText, x, y, w, h, color -> pixel);
+
+    if (drw -> ntext + len > drw -> textsize) {
+        drw -> textsize = MAX(drw -> textsize * 2, drw -> ntext + len);
+        drw -> text = erealloc(drw -> text, drw -> textsize);
+    }
+
+    memcpy(drw -> text + drw -> ntext, text, len);
+    op -> color = color;
+    op -> font = font;
+    op -> ty = ty;
+    op -> text = drw -> ntext;
+    op -> len = len;
+    drw -> ntext += len;
+}
+
+
+/* One XFillRectangles per fill color and one XftDrawGlyphFontSpec per text
+ * color, whatever the number of cells and fonts. */
+static void dl_submit(Drw *drw) {
+    XRectangle *rects;
+    XftGlyphFontSpec *specs;
+    XGlyphInfo ext;
+    XftDraw *d = NULL;
+    DrwOp *op, *o;
+    size_t i, j, k, n, nglyphs = 0;
+    long cp;
+    int x;
+
+    if (!drw -> nops) { return; }
+
+    if (drw -> shm) {
+        dl_raster(drw);
+        drw -> nops = drw -> ntext = 0;
+        return;
+    }
+
+    rects = ecalloc(drw -> nops, sizeof(XRectangle));
+    specs = ecalloc(drw -> ntext + 1, sizeof(XftGlyphFontSpec));
+
+    for (i = 0; i < drw -> nops; i++) {
+        op = &drw -> ops[i];
+
+        if (op -> type == DrwCopy) {
+            XCopyArea(drw -> dpy, op -> src, drw -> drawable, drw -> gc,
+                      op -> sx, op -> sy, op -> w, op -> h, op -> x, op -> y);
+            drw -> framereqs++;
+        }
+    }
+
+    /* ops already batched with an earlier one are marked by a negative type */
+    for (i = 0; i < drw -> nops; i++) {
+        op = &drw -> ops[i];
+
+        if (op -> type == DrwFill) {
+            for (n = 0, j = i; j < drw -> nops; j++) {
+                o = &drw -> ops[j];
+
+                if (o -> type != DrwFill || o -> pixel != op -> pixel) { continue; }
+
+                rects[n].x = o -> x;
+                rects[n].y = o -> y;
+                rects[n].width = o -> w;
+                rects[n].height = o -> h;
+                n++;
+
+                if (o != op) { o -> type = -1; }
+            }
+
+            XSetForeground(drw -> dpy, drw -> gc, op -> pixel);
+            XFillRectangles(drw -> dpy, drw -> drawable, drw -> gc, rects, n);
+            drw -> framereqs += 2;
+        }
+    }
+
+    for (i = 0; i < drw -> nops; i++) {
+        op = &drw -> ops[i];
+
+        if (op -> type == DrwText) {
+            if (!d) {
+                d = XftDrawCreate(drw -> dpy, drw -> drawable,
+                                  DefaultVisual(drw -> dpy, drw -> screen),
+                                  DefaultColormap(drw -> dpy, drw -> screen));
+            }
+
+            for (nglyphs = 0, j = i; j < drw -> nops; j++) {
+                o = &drw -> ops[j];
+
+                if (o -> type != DrwText || o -> color -> pixel != op -> color -> pixel) { continue; }
+
+                for (k = 0, x = o -> x; k < o -> len; k += n ? n : 1) {
+                    n = utf8decode(drw -> text + o -> text + k, &cp, o -> len - k);
+
+                    specs[nglyphs].font = o -> font;
+                    specs[nglyphs].glyph = XftCharIndex(drw -> dpy, o -> font, cp);
+                    specs[nglyphs].x = x;
+                    specs[nglyphs].y = o -> ty;
+                    XftGlyphExtents(drw -> dpy, o -> font, &specs[nglyphs].glyph, 1, &ext);
+                    x += ext.xOff;
+                    nglyphs++;
+                }
+
+                if (o != op) { o -> type = -1; }
+            }
+
+            XftDrawGlyphFontSpec(d, op -> color, specs, nglyphs);
+            drw -> framereqs++;
+        }
+    }
+
+    if (d) { XftDrawDestroy(d); }
+
+    free(rects);
+    free(specs);
+    drw -> nops = drw -> ntext = 0;
+}
+
+
 Drw *drw_create(Display *dpy, int screen, Window root, 
                 unsigned int w, unsigned int h) {
 
@@ -120,6 +316,7 @@ Drw *drw_create(Display *dpy, int screen, Window root,
     drw -> h = h;
     drw -> drawable = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
     drw -> gc = XCreateGC(dpy, root, 0, NULL);
+    drw -> shmok = -1;
 
     XSetLineAttributes(dpy, drw -> gc, 1, LineSolid, CapButt, JoinMiter);
 
@@ -130,6 +327,8 @@ Drw *drw_create(Display *dpy, int screen, Window root,
 void drw_resize(Drw *drw, unsigned int w, unsigned int h) {
     if (!drw) { return; }
 
+    shm_release(drw); /* recreated at the new size by the next frame */
+
     drw -> w = w;
     drw -> h = h;
 
@@ -141,12 +340,327 @@ void drw_resize(Drw *drw, unsigned int w, unsigned int h) {
 
 
 void drw_free(Drw *drw) {
+    size_t i;
+
+    shm_release(drw);
+
+    if (drw -> srcimg) { XDestroyImage(drw -> srcimg); }
+
+    if (drw -> glyphs) {
+        for (i = 0; i < GLYPHS; i++) { free(drw -> glyphs[i].bits); }
+
+        free(drw -> glyphs);
+    }
+
     XFreePixmap(drw -> dpy, drw -> drawable);
     XFreeGC(drw -> dpy, drw -> gc);
+    free(drw -> ops);
+    free(drw -> text);
     free(drw);
 }
 
 
+/* Select the shared memory backend: display lists are rasterised into an
+ * XImage in a segment shared with the server and put with one request.
+ * Only local servers with a 32 bit TrueColor visual qualify; returns
+ * whether the backend is in use. */
+int drw_setshm(Drw *drw, int on) {
+    const xcb_query_extension_reply_t *ext;
+    const char *name;
+    Visual *v;
+
+    if (!drw) { return 0; }
+
+    if (on && drw -> shmok < 0) {
+        name = DisplayString(drw -> dpy);
+        v = DefaultVisual(drw -> dpy, drw -> screen);
+        ext = xcb_get_extension_data(XGetXCBConnection(drw -> dpy), &xcb_shm_id);
+        drw -> shmok = (name[0] == ':' || !strncmp(name, "unix:", 5)) &&
+                       ext && ext -> present && v -> class == TrueColor &&
+                       v -> red_mask == 0xff0000 && v -> green_mask == 0xff00 && v -> blue_mask == 0xff;
+    }
+
+    if (!on || !drw -> shmok) { shm_release(drw); }
+
+    return (drw -> shm = on && drw -> shmok);
+}
+
+
+static int shm_create(Drw *drw, unsigned int w, unsigned int h) {
+    xcb_connection_t *xc = XGetXCBConnection(drw -> dpy);
+    xcb_generic_error_t *err = NULL;
+    XImage *img;
+    int id;
+
+    if (drw -> shmimg && drw -> shmimg -> width >= (int)w && drw -> shmimg -> height >= (int)h) {
+        return 1;
+    }
+
+    shm_release(drw);
+
+    img = XCreateImage(drw -> dpy, DefaultVisual(drw -> dpy, drw -> screen),
+                       DefaultDepth(drw -> dpy, drw -> screen), ZPixmap, 0, NULL, w, h, 32, 0);
+
+    if (!img) { return 0; }
+
+    if (img -> bits_per_pixel != 32 ||
+        (id = shmget(IPC_PRIVATE, img -> bytes_per_line * h, IPC_CREAT | 0600)) < 0) {
+        XDestroyImage(img);
+        return 0;
+    }
+
+    img -> data = shmat(id, NULL, 0);
+
+    /* checked, so a server refusing the segment is an error here rather than in xerror() */
+    if (img -> data != (char *)-1) {
+        drw -> shmseg = xcb_generate_id(xc);
+        err = xcb_request_check(xc, xcb_shm_attach_checked(xc, drw -> shmseg, id, 0));
+    }
+
+    /* the segment goes away with the last detach */
+    shmctl(id, IPC_RMID, NULL);
+
+    if (img -> data == (char *)-1 || err) {
+        if (img -> data != (char *)-1) { shmdt(img -> data); }
+
+        free(err);
+        img -> data = NULL;
+        XDestroyImage(img);
+        return 0;
+    }
+
+    drw -> shmimg = img;
+
+    return 1;
+}
+
+
+static void shm_release(Drw *drw) {
+    if (!drw -> shmimg) { return; }
+
+    xcb_shm_detach(XGetXCBConnection(drw -> dpy), drw -> shmseg);
+    shmdt(drw -> shmimg -> data);
+    drw -> shmimg -> data = NULL;
+    XDestroyImage(drw -> shmimg);
+    drw -> shmimg = NULL;
+}
+
+
+/* The load flags and render mode Xft derives from the font pattern, so both
+ * backends draw the same glyphs. Subpixel fonts come out gray here. */
+static FT_Int32 glyph_loadflags(XftFont *font, FT_Render_Mode *mode, FcBool *embolden) {
+    FcBool antialias = FcTrue, hinting = FcTrue, autohint = FcFalse;
+    FT_Int32 flags = FT_LOAD_DEFAULT;
+    int style = FC_HINT_FULL;
+
+    *embolden = FcFalse;
+    FcPatternGetBool(font -> pattern, FC_ANTIALIAS, 0, &antialias);
+    FcPatternGetBool(font -> pattern, FC_HINTING, 0, &hinting);
+    FcPatternGetInteger(font -> pattern, FC_HINT_STYLE, 0, &style);
+    FcPatternGetBool(font -> pattern, FC_AUTOHINT, 0, &autohint);
+    FcPatternGetBool(font -> pattern, FC_EMBOLDEN, 0, embolden);
+
+    if (!hinting) { style = FC_HINT_NONE; }
+
+    if (!antialias) {
+        flags |= FT_LOAD_TARGET_MONO;
+        *mode = FT_RENDER_MODE_MONO;
+    } else if (style > FC_HINT_NONE && style < FC_HINT_FULL) {
+        flags |= FT_LOAD_TARGET_LIGHT;
+        *mode = FT_RENDER_MODE_LIGHT;
+    } else {
+        *mode = FT_RENDER_MODE_NORMAL;
+    }
+
+    if (style == FC_HINT_NONE) { flags |= FT_LOAD_NO_HINTING; }
+    if (autohint) { flags |= FT_LOAD_FORCE_AUTOHINT; }
+
+    return flags;
+}
+
+
+/* the glyph of font rasterised by FreeType, from the cache if it is there */
+static DrwGlyph *glyph_get(Drw *drw, XftFont *font, unsigned int glyph) {
+    DrwGlyph *g = NULL;
+    FT_Face face;
+    FT_Bitmap *bm;
+    FT_Int32 flags;
+    FT_Render_Mode mode;
+    FcBool embolden;
+    XGlyphInfo ext;
+    unsigned int x, y, h;
+    int i, ok = 0;
+
+    if (!drw -> glyphs) { drw -> glyphs = ecalloc(GLYPHS, sizeof(DrwGlyph)); }
+
+    h = ((uintptr_t)font >> 4 ^ glyph * 2654435761u) & (GLYPHS - 1);
+
+    for (i = 0; i < GLYPHPROBE; i++) {
+        g = &drw -> glyphs[(h + i) & (GLYPHS - 1)];
+
+        if (g -> font == font && g -> glyph == glyph) { return g; }
+
+        if (!g -> font) { break; }
+    }
+
+    /* a full probe sequence gives up its last slot */
+    free(g -> bits);
+    memset(g, 0, sizeof(DrwGlyph));
+
+    if (!(face = XftLockFace(font))) { return NULL; }
+
+    flags = glyph_loadflags(font, &mode, &embolden);
+
+    if (!FT_Load_Glyph(face, glyph, flags)) {
+        if (embolden && face -> glyph -> format == FT_GLYPH_FORMAT_OUTLINE) {
+            FT_GlyphSlot_Embolden(face -> glyph);
+        }
+
+        ok = !FT_Render_Glyph(face -> glyph, mode);
+    }
+
+    if (ok) {
+        bm = &face -> glyph -> bitmap;
+        g -> left = face -> glyph -> bitmap_left;
+        g -> top = face -> glyph -> bitmap_top;
+        g -> w = bm -> width;
+        g -> h = bm -> rows;
+        g -> bits = ecalloc(g -> w * g -> h + 1, 1);
+
+        for (y = 0; y < g -> h; y++) {
+            for (x = 0; x < g -> w; x++) {
+                if (bm -> pixel_mode == FT_PIXEL_MODE_MONO) {
+                    g -> bits[y * g -> w + x] = bm -> buffer[y * bm -> pitch + x / 8] & 0x80 >> x % 8 ? 255 : 0;
+                } else {
+                    g -> bits[y * g -> w + x] = bm -> buffer[y * bm -> pitch + x];
+                }
+            }
+        }
+    }
+
+    XftUnlockFace(font);
+
+    XftGlyphExtents(drw -> dpy, font, &glyph, 1, &ext);
+    g -> adv = ext.xOff;
+    g -> font = font;
+    g -> glyph = glyph;
+
+    return g;
+}
+
+
+/* Blend a row of coverage values over dst. Red and blue are blended in one
+ * multiply and green in another, so a 32 bit lane carries two channels. */
+static void blendrow(uint32_t *dst, const unsigned char *a, unsigned int n, uint32_t color) {
+    uint32_t rb = color & 0xff00ff, g = color & 0x00ff00, d, k;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        k = a[i] + (a[i] >> 7); /* 0..256, so full coverage is exact */
+        d = dst[i];
+        dst[i] = ((rb * k + (d & 0xff00ff) * (256 - k)) >> 8 & 0xff00ff) |
+                 ((g * k + (d & 0x00ff00) * (256 - k)) >> 8 & 0x00ff00);
+    }
+}
+
+
+/* a client-side copy of src, which is expected not to change, as the
+ * sprite sheets do not */
+static XImage *shm_source(Drw *drw, Drawable src) {
+    Window root;
+    int di;
+    unsigned int w, h, du;
+
+    if (drw -> srcdrawable == src) { return drw -> srcimg; }
+
+    if (drw -> srcimg) { XDestroyImage(drw -> srcimg); }
+
+    drw -> srcimg = NULL;
+    drw -> srcdrawable = src;
+
+    if (XGetGeometry(drw -> dpy, src, &root, &di, &di, &w, &h, &du, &du)) {
+        drw -> srcimg = XGetImage(drw -> dpy, src, 0, 0, w, h, AllPlanes, ZPixmap);
+    }
+
+    if (drw -> srcimg && drw -> srcimg -> bits_per_pixel != 32) {
+        XDestroyImage(drw -> srcimg);
+        drw -> srcimg = NULL;
+    }
+
+    return drw -> srcimg;
+}
+
+
+/* clip the w x h area at *x, *y to img, adjusting the source offset */
+static int clip(XImage *img, int *x, int *y, int *sx, int *sy, int *w, int *h) {
+    if (*x < 0) { *sx -= *x; *w += *x; *x = 0; }
+    if (*y < 0) { *sy -= *y; *h += *y; *y = 0; }
+    if (*x + *w > img -> width) { *w = img -> width - *x; }
+    if (*y + *h > img -> height) { *h = img -> height - *y; }
+
+    return *w > 0 && *h > 0;
+}
+
+
+/* draw the recording into shmimg, in order */
+static void dl_raster(Drw *drw) {
+    XImage *img = drw -> shmimg, *si;
+    DrwGlyph *g;
+    DrwOp *op;
+    uint32_t *row;
+    size_t i, k, n;
+    long cp;
+    int x, y, sx, sy, w, h, j, pen;
+
+    for (i = 0; i < drw -> nops; i++) {
+        op = &drw -> ops[i];
+        x = op -> x, y = op -> y, sx = op -> sx, sy = op -> sy, w = op -> w, h = op -> h;
+
+        if (op -> type == DrwFill) {
+            if (!clip(img, &x, &y, &sx, &sy, &w, &h)) { continue; }
+
+            for (; h--; y++) {
+                row = (uint32_t *)(img -> data + y * img -> bytes_per_line) + x;
+
+                for (j = 0; j < w; j++) { row[j] = op -> pixel; }
+            }
+        } else if (op -> type == DrwCopy) {
+            if (!(si = shm_source(drw, op -> src))) { continue; }
+
+            /* the source bounds the copy as well */
+            w = MIN(w, si -> width - sx);
+            h = MIN(h, si -> height - sy);
+
+            if (!clip(img, &x, &y, &sx, &sy, &w, &h)) { continue; }
+
+            for (; h--; y++, sy++) {
+                memcpy(img -> data + y * img -> bytes_per_line + x * 4,
+                       si -> data + sy * si -> bytes_per_line + sx * 4, w * 4);
+            }
+        } else if (op -> type == DrwText) {
+            for (k = 0, pen = op -> x; k < op -> len; k += n ? n : 1) {
+                n = utf8decode(drw -> text + op -> text + k, &cp, op -> len - k);
+
+                if (!(g = glyph_get(drw, op -> font, XftCharIndex(drw -> dpy, op -> font, cp)))) {
+                    continue;
+                }
+
+                x = pen + g -> left, y = op -> ty - g -> top, sx = sy = 0, w = g -> w, h = g -> h;
+                pen += g -> adv;
+
+                if (!g -> bits || !clip(img, &x, &y, &sx, &sy, &w, &h)) { continue; }
+
+                for (j = 0; j < h; j++) {
+                    blendrow((uint32_t *)(img -> data + (y + j) * img -> bytes_per_line) + x,
+                             g -> bits + (sy + j) * g -> w + sx, w, op -> color -> pixel);
+                }
+            }
+        }
+    }
+}
+
+
+
 /* This function is an implementation detail. Library users should use
  * drw_fontset_create instead.
  */
@@ -279,6 +793,15 @@ void drw_rect(Drw *drw, int x, int y, unsigned int w,
 
     if (!drw || !drw -> scheme) { return; }
 
+    if (drw -> recording) {
+        if (filled) {
+            dl_fill(drw, invert ? drw -> scheme[ColBg].pixel : drw -> scheme[ColFg].pixel, x, y, w, h);
+            return;
+        }
+
+        dl_submit(drw);
+    }
+
     XSetForeground(drw -> dpy, drw -> gc, invert ? drw -> scheme[ColBg].pixel : drw -> scheme[ColFg].pixel);
 
     if (filled) { 
@@ -312,6 +835,10 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h,
 
     if (!render) {
         w = ~w;
+    } else if (drw -> recording) {
+        dl_fill(drw, drw -> scheme[invert ? ColFg : ColBg].pixel, x, y, w, h);
+        x += lpad;
+        w -= lpad;
     } else {
         XSetForeground(drw -> dpy, drw -> gc, drw -> scheme[invert ? ColFg : ColBg].pixel);
         XFillRectangle(drw -> dpy, drw -> drawable, drw -> gc, x, y, w, h);
@@ -365,8 +892,14 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h,
 
                 if (render) {
                     ty = y + (h - usedfont -> h) / 2 + usedfont -> xfont -> ascent;
-                    XftDrawStringUtf8(d, &drw -> scheme[invert ? ColBg : ColFg],
-                                      usedfont -> xfont, x, ty, (XftChar8 *)buf, len);
+
+                    if (drw -> recording) {
+                        dl_text(drw, &drw -> scheme[invert ? ColBg : ColFg], usedfont -> xfont,
+                                x, y, ew, h, ty, buf, len);
+                    } else {
+                        XftDrawStringUtf8(d, &drw -> scheme[invert ? ColBg : ColFg],
+                                          usedfont -> xfont, x, ty, (XftChar8 *)buf, len);
+                    }
                 }
 
                 x += ew;
@@ -423,6 +956,59 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h,
 }
 
 
+void drw_copy(Drw *drw, Drawable src, int sx, int sy, unsigned int w,
+              unsigned int h, int x, int y) {
+
+    DrwOp *op;
+
+    if (!drw) { return; }
+
+    if (!drw -> recording) {
+        XCopyArea(drw -> dpy, src, drw -> drawable, drw -> gc, sx, sy, w, h, x, y);
+        return;
+    }
+
+    op = dl_push(drw, DrwCopy, x, y, w, h, 0);
+    op -> src = src;
+    op -> sx = sx;
+    op -> sy = sy;
+}
+
+
+void drw_begin(Drw *drw) {
+    if (!drw) { return; }
+
+    /* Xft draws this frame and the later ones if no segment can be had */
+    if (drw -> shm && !shm_create(drw, drw -> w, drw -> h)) { drw -> shm = drw -> shmok = 0; }
+
+    drw -> recording = 1;
+    drw -> nops = drw -> ntext = 0;
+    drw -> frameops = drw -> framereqs = 0;
+}
+
+
+/* submit what was recorded since drw_begin() and copy the area to win */
+void drw_end(Drw *drw, Window win, int x, int y, 
+             unsigned int w, unsigned int h) {
+
+    if (!drw) { return; }
+
+    dl_submit(drw);
+    drw -> recording = 0;
+    drw -> framereqs++;
+
+    if (drw -> shm) {
+        XFlushGC(drw -> dpy, drw -> gc);
+        xcb_shm_put_image(XGetXCBConnection(drw -> dpy), win, XGContextFromGC(drw -> gc),
+                          drw -> shmimg -> width, drw -> shmimg -> height, x, y, w, h, x, y,
+                          drw -> shmimg -> depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, drw -> shmseg, 0);
+        XSync(drw -> dpy, False); /* the server is done reading the segment */
+    } else {
+        drw_map(drw, win, x, y, w, h);
+    }
+}
+
+
 void drw_map(Drw *drw, Window win, int x, int y, 
              unsigned int w, unsigned int h) {
 
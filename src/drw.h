@@ -56,6 +56,29 @@ typedef struct Fnt {
 enum { ColFg, ColBg, ColBorder }; /* Clr scheme index */
 typedef XftColor Clr;
 
+enum { DrwCopy, DrwFill, DrwText }; /* display list operations, in submit order */
+
+typedef struct {
+    int type;
+    int x, y;
+    unsigned int w, h;     /* area the operation paints */
+    unsigned long pixel;   /* DrwFill, and the color of DrwText */
+    Clr *color;            /* DrwText */
+    XftFont *font;
+    int ty;
+    size_t text, len;      /* offset into the text buffer */
+    Drawable src;          /* DrwCopy */
+    int sx, sy;
+} DrwOp;
+
+typedef struct {          /* glyph rasterised for the shared memory backend */
+    XftFont *font;
+    unsigned int glyph;
+    int left, top, adv;
+    unsigned int w, h;
+    unsigned char *bits;   /* w * h coverage values */
+} DrwGlyph;
+
 typedef struct {
     unsigned int w, h;
     Display *dpy;
@@ -65,6 +88,19 @@ typedef struct {
     GC gc;
     Clr *scheme;
     Fnt *fonts;
+    int recording;         /* between drw_begin() and drw_end() */
+    DrwOp *ops;
+    size_t nops, opsize;
+    char *text;
+    size_t ntext, textsize;
+    unsigned int frameops, framereqs; /* recorded operations and requests of the last frame */
+    int shm;               /* display lists are rasterised into shmimg, see drw_setshm() */
+    int shmok;             /* -1 until the server was checked */
+    unsigned long shmseg;  /* shmimg -> data as attached to the server */
+    XImage *shmimg;
+    XImage *srcimg;        /* client-side copy of the last drw_copy() source */
+    Drawable srcdrawable;
+    DrwGlyph *glyphs;
 } Drw;
 
 
@@ -75,6 +111,7 @@ Drw *drw_create(Display *dpy, int screen, Window win,
                 
 void drw_resize(Drw *drw, unsigned int w, unsigned int h);
 void drw_free(Drw *drw);
+int drw_setshm(Drw *drw, int on);
 
 
 /* Fnt abstraction */
@@ -108,6 +145,16 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h,
              unsigned int lpad, const char *text, int invert);
 
 
+void drw_copy(Drw *drw, Drawable src, int sx, int sy, unsigned int w,
+              unsigned int h, int x, int y);
+
+
+/* Display list, records drawing until drw_end() submits it batched */
+void drw_begin(Drw *drw);
+void drw_end(Drw *drw, Window win, int x, int y, 
+             unsigned int w, unsigned int h);
+
+
 /* Map functions */
 void drw_map(Drw *drw, Window win, int x, int y, 
              unsigned int w, unsigned int h);
@@ -42,13 +42,18 @@ DEALINGS IN THE SOFTWARE.
 
 
 #include <errno.h>
+#include <limits.h>
 #include <locale.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
@@ -58,6 +63,7 @@ DEALINGS IN THE SOFTWARE.
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/Xinerama.h>
+#include <X11/extensions/sync.h>
 #include <X11/Xft/Xft.h>
 #include <X11/Xlib-xcb.h>
 #include <xcb/res.h>
@@ -77,16 +83,26 @@ DEALINGS IN THE SOFTWARE.
 #define HEIGHT(X)               ((X) -> h + 2 * (X) -> bw)
 #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
 #define TEXTW(X)                (drw_fontset_getwidth(drw, (X)) + lrpad)
+#define TAGSPRITE(I, S, U)      (((I) * 2 + !!(S)) * 2 + !!(U)) /* tag label in Sprites */
 
 /* enums */
 enum { CurNormal, CurResize, CurMove, CurLast }; /* cursor */
-enum { SchemeNorm, SchemeSel }; /* color schemes */
+enum { SchemeNorm, SchemeSel, SchemeHung }; /* color schemes */
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
-       NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+       NetWMFullscreen, NetWMHidden, NetActiveWindow, NetWMWindowType,
+       NetWMWindowTypeDialog, NetClientList, NetWMSyncRequest,
+       NetWMSyncRequestCounter, NetWMPing, NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkTabBar, ClkLtSymbol, ClkStatusText,
        ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
+enum { GrabNone, GrabFocused, GrabUnfocused }; /* client button grabs */
+enum { FreezeNone, FreezeSignal, FreezeCgroup }; /* how a client process is frozen */
+enum { SchedNone, SchedFg, SchedBg }; /* client scheduling classes */
+enum { PendingTitle = 1, PendingSizeHints = 2 }; /* properties changed while hidden */
+enum { TimerFreeze, TimerSched, TimerStats, TimerDwell, TimerConfigure,
+       TimerPing, TimerLast }; /* timers */
+enum { PropNetName, PropName, PropClass, PropTransient, PropState,
+       PropType, PropNormalHints, PropHints, PropProtocols, PropLast }; /* properties fetched for new windows */
 
 typedef union {
     int i;
@@ -114,11 +130,34 @@ struct Client {
     int oldx, oldy, oldw, oldh;
     int basew, baseh, incw, inch, maxw, maxh, minw, minh;
     int bw, oldbw;
+    int curbw;            /* border width currently set on win */
     unsigned int tags;
     int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, isterminal, noswallow;
+    int isdeferred;       /* covered by another tiled client, not moved to its layout slot yet */
+    int isnew;            /* never configured by dynamd, the next resize() is forced */
+    int iscovered;        /* behind the front client of monocle/deck, advertised as hidden */
+    int iconify;          /* unmap instead of moving off-screen while on a hidden tag */
+    int isiconic;         /* win was unmapped by dynamd, mapped again once visible */
+    int ignoreunmap;      /* UnmapNotify events caused by dynamd still to arrive */
+    int freeze;           /* stop the process after freezedelay on a hidden tag */
+    int outline;          /* moved and resized by outline instead of live */
+    int pending;          /* Pending* properties to refetch once visible */
+    XConfigureRequestEvent cfgreq; /* pending ConfigureRequest, merged field by field */
+    int cfgpending;
+    double cfgtokens;     /* token bucket limiting how often ConfigureRequests are applied */
+    long cfgstamp;        /* nowms() of the last refill */
+    unsigned int ncfg, ncfgapplied; /* ConfigureRequests received and applied since the last report */
+    int canping;          /* speaks _NET_WM_PING */
+    int isunresponsive;   /* left the last ping unanswered, gets no optional messages */
+    long pingsent;        /* nowms() of the unanswered ping, 0 if none */
+    long pingms;          /* round trip of the last answered ping */
+    int isfrozen;         /* Freeze* method the process was stopped with */
+    long hiddenat;        /* nowms() when the tags were hidden, 0 while visible */
+    int sched;            /* Sched* class applied to the process */
+    int grabstate;        /* button grabs currently set on win */
     pid_t pid;
-    Client *next;
-    Client *snext;
+    Client *next, *prev;
+    Client *snext, *sprev;
     Client *swallowing;
     Monitor *mon;
     Window win;
@@ -161,18 +200,44 @@ struct Monitor {
     int showtab;
     int topbar;
     int toptab;
-    Client *clients;
+    Client *clients, *ctail;
     Client *sel;
     Client *stack;
     Monitor *next;
     Window barwin;
     Window tabwin;
-    int ntabs;
+    Window inputwin;      /* InputOnly, below all clients, reports the pointer entering the monitor */
+    int ntabs;            /* tabs and ltsymbol as last drawn, under barlock */
     int tab_widths[25];
+    int ltw;
     const Layout *lt[2];
     Pertag *pertag;
 };
 
+typedef struct {          /* pre-rendered bar labels, see buildsprites() */
+    Pixmap pm;
+    int *x, *w;
+} Sprites;
+
+typedef struct BarFrame BarFrame;
+struct BarFrame {         /* what a bar or tab bar shows, drawn by the render thread */
+    Window win;
+    Monitor *m;           /* gets the measured widths */
+    int istab;
+    int ww;
+    char ltsymbol[16];
+    unsigned int occ, urg, tagset;
+    char stext[256];
+    int ltw;
+    int ntabs;
+    int tabscheme[25];
+    int tabw[25];
+    char names[25][256];
+    unsigned int ops, reqs; /* drawing operations recorded and requests sent */
+    int shm;              /* rasterise client-side, if the server allows */
+    BarFrame *next;
+};
+
 typedef struct {
     const char *class;
     const char *instance;
@@ -181,16 +246,31 @@ typedef struct {
     int isfloating;
     int isterminal;
     int noswallow;
+    int iconify;
+    int freeze;
+    int outline;
     int monitor;
 } Rule;
 
+typedef struct {
+    long at;              /* nowms() to fire at, 0 when disarmed */
+    void (*func)();
+} Timer;
+
+typedef struct {
+    xcb_get_property_cookie_t prop[PropLast];
+    xcb_res_query_client_ids_cookie_t pid;
+} WinProps;
+
 
 /* function declarations */
-static void applyrules(Client *c);
+static void applyrules(Client *c, xcb_get_property_reply_t *cls);
 static int  applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
+static void armtimer(int t, long at);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
 static void attach(Client *c);
+static void attachbefore(Client *c, Client *at);
 static void attachbottom(Client *c);
 static void attachstack(Client *c);
 static void buttonpress(XEvent *e);
@@ -201,6 +281,10 @@ static void clientmessage(XEvent *e);
 static void configure(Client *c);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
+static void applyconfigure(Client *c);
+static void flushconfigures();
+static void queueconfigure(Client *c, XConfigureRequestEvent *ev);
+static int  takecfgtoken(Client *c);
 static Monitor *createmon();
 static void cyclelayout(const Arg *arg);
 static void destroynotify(XEvent *e);
@@ -211,7 +295,22 @@ static void drawbar(Monitor *m);
 static void drawbars();
 static void drawtab(Monitor *m);
 static void drawtabs();
+static void postframe(BarFrame *f);
+static void publishframe(BarFrame *f);
+static void renderbar(Drw *drw, Clr **scheme, Sprites *sp, BarFrame *f);
+static void renderframe(Drw *drw, Clr **scheme, Sprites *sp, BarFrame *f);
+static void *renderloop(void *arg);
+static void rendertab(Drw *drw, Clr **scheme, BarFrame *f);
+static void startrender();
+static void buildsprites(Drw *drw, Clr **scheme, Sprites *sp);
+static void freesprites(Drw *drw, Sprites *sp);
+static void stoprender();
+static void drawoutline(int x, int y, int w, int h);
+static void hideoutline();
+static int  useoutline(const Client *c);
+static void dwellfocus();
 static void enternotify(XEvent *e);
+static void enterwin(Window w);
 static void expose(XEvent *e);
 static void focus(Client *c);
 static void focusin(XEvent *e);
@@ -219,19 +318,31 @@ static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
 static void movestack(const Arg *arg);
 static void focuswin(const Arg* arg);
+static void freezeclients();
+static int  getcgroup(pid_t pid, char *path, size_t size, int dedicated);
+static int  thaw(pid_t pid, int how);
+static Client *pidsibling(const Client *c);
+static int  ismonwin(Window w);
+static int  getptr(int *x, int *y);
 static int  getrootptr(int *x, int *y);
 static long getstate(Window w);
 static int  gettextprop(Window w, Atom atom, char *text, unsigned int size);
 static void grabbuttons(Client *c, int focused);
 static void grabkeys();
+static void ignoreenters();
+static int  isoccluded(Client *c, int x, int y, int w, int h);
 static void keypress(XEvent *e);
 static void killclient(const Arg *arg);
-static void manage(Window w, XWindowAttributes *wa);
+static void manage(Window w, XWindowAttributes *wa, const WinProps *wp);
 static void mappingnotify(XEvent *e);
 static void maprequest(XEvent *e);
-static void motionnotify(XEvent *e);
 static void movemouse(const Arg *arg);
 static Client *nexttiled(Client *c);
+static Client *toptiled(Monitor *m, unsigned int skip);
+static int  nexttimeout();
+static long nowms();
+static void pingclients();
+static void pong(Client *c, long stamp);
 static void pop(Client *);
 static void propertynotify(XEvent *e);
 static Monitor *recttomon(int x, int y, int w, int h);
@@ -240,23 +351,37 @@ static void resize(Client *c, int x, int y, int w, int h, int interact);
 static void resizeclient(Client *c, int x, int y, int w, int h);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
+static void reportwakeups();
 static void run();
+static void runtimers();
+static void schedclients();
 static void scan();
+static int  hasprotocol(Client *c, Atom proto);
 static int  sendevent(Client *c, Atom proto);
+static void sendsyncrequest(Client *c, unsigned long value);
+static XSyncCounter getsynccounter(Client *c);
+static Bool isdragevent(Display *d, XEvent *ev, XPointer arg);
+static int  syncresize(Client *c, int w, int h, XSyncAlarm alarm, unsigned long *value);
 static void sendmon(Client *c, Monitor *m);
 static void setclientstate(Client *c, long state);
 static void setfocus(Client *c);
+static void setfrozen(Client *c, int frozen);
+static void setptr(int x, int y);
+static void setsched(Client *c, int sched);
 static void setfullscreen(Client *c, int fullscreen);
+static void seticonic(Client *c, int iconic);
 static void setlayout(const Arg *arg);
 static void setmfact(const Arg *arg);
 static void setup();
 static void seturgent(Client *c, int urg);
 static void showhide(Client *c);
+static void showiconic(Monitor *m);
 static void sigchld(int unused);
 static void spawn(const Arg *arg);
 static void tag(const Arg *arg);
 static void tagmon(const Arg *arg);
 static void togglebar(const Arg *arg);
+static void togglebarshm(const Arg *arg);
 static void togglefloating(const Arg *arg);
 static void togglefullscr(const Arg *arg);
 static void toggletag(const Arg *arg);
@@ -267,17 +392,24 @@ static void unmapnotify(XEvent *e);
 static void updatebarpos(Monitor *m);
 static void updatebars();
 static void updateclientlist();
+static void updatecovered(Monitor *m);
+static void updatenetstate(Client *c);
 static int  updategeom();
 static void updatenumlockmask();
+static void updatepending(Client *c);
 static void updatesizehints(Client *c);
+static void setsizehints(Client *c, XSizeHints *size);
 static void updatestatus();
 static void updatetitle(Client *c);
 static void updatewindowtype(Client *c);
+static void setwindowtype(Client *c, Atom state, Atom wtype);
 static void updatewmhints(Client *c);
+static void setwmhints(Client *c, XWMHints *wmh);
 static void view(const Arg *arg);
 static void warp(const Client *c);
 static Client *wintoclient(Window w);
 static Monitor *wintomon(Window w);
+static int  writecgroup(pid_t pid, const char *file, const char *value, int dedicated);
 static int  xerror(Display *dpy, XErrorEvent *ee);
 static int  xerrordummy(Display *dpy, XErrorEvent *ee);
 static int  xerrorstart(Display *dpy, XErrorEvent *ee);
@@ -308,23 +440,39 @@ static void gaps(const Arg *arg);
 static void getfacts(Monitor *m, int msize, int ssize, float *mf, float *sf, int *mr, int *sr);
 
 
+static int   canfreeze(const Client *c);
 static pid_t getparentprocess(pid_t p);
+static Atom  atomreply(xcb_get_property_reply_t *r);
+static Window windowreply(xcb_get_property_reply_t *r);
+static int   atomsreplyhas(xcb_get_property_reply_t *r, Atom atom);
+static unsigned long cardinalreply(xcb_get_property_reply_t *r);
+static void  discardprops(const WinProps *wp);
+static pid_t pidreply(xcb_res_query_client_ids_cookie_t ck);
+static xcb_get_property_cookie_t getprop(Window w, Atom atom, Atom type, uint32_t len);
+static xcb_get_property_reply_t *propreply(xcb_get_property_cookie_t ck);
+static void  requestprops(Window w, WinProps *wp);
+static int   sizehintsreply(xcb_get_property_reply_t *r, XSizeHints *size);
+static int   textprop(XTextProperty *name, char *text, unsigned int size);
+static int   utf8copy(char *text, const unsigned char *s, unsigned long len, unsigned int size);
+static int   textreply(xcb_get_property_reply_t *r, char *text, unsigned int size);
+static int   wmhintsreply(xcb_get_property_reply_t *r, XWMHints *wmh);
 static int   isdescprocess(pid_t p, pid_t c);
+static void  swapwindows(Client *a, Client *b);
 static Client *swallowingclient(Window w);
 static Client *termforwin(const Client *c);
-static pid_t winpid(Window w);
 
 /* variables */
 static const char broken[] = "broken";
 static char stext[256];
 static int screen;
 static int sw, sh;           /* X display screen geometry width, height */
-static int bh, blw = 0;      /* bar geometry */
+static int bh;               /* bar geometry */
 static int th = 0;           /* tab bar geometry */
 static int enablegaps = 1;   /* enables gaps, used by togglegaps */
 static int lrpad;            /* sum of left and right padding for text */
 static int (*xerrorxlib)(Display *, XErrorEvent *);
 static unsigned int numlockmask = 0;
+static int numlockstale = 1; /* numlockmask must be refetched, set on MappingNotify */
 static void (*handler[LASTEvent]) (XEvent *) = {
     [ButtonPress] = buttonpress,
     [ClientMessage] = clientmessage,
@@ -337,19 +485,47 @@ static void (*handler[LASTEvent]) (XEvent *) = {
     [KeyPress] = keypress,
     [MappingNotify] = mappingnotify,
     [MapRequest] = maprequest,
-    [MotionNotify] = motionnotify,
     [PropertyNotify] = propertynotify,
     [UnmapNotify] = unmapnotify
 };
 static Atom wmatom[WMLast], netatom[NetLast];
+static Atom utf8string;
 static int running = 1;
+static unsigned int nwakeups, nevents; /* since the last reportwakeups() */
+static int canrenice; /* nice values raised by setsched() can be lowered back */
+static struct { pid_t pid; int how; } unthawed[8]; /* of unmanaged clients, thawing failed */
+static Window dwellwin; /* last window the pointer entered, focused by dwellfocus() */
+static unsigned long enterseq; /* crossing events with a lower serial were caused by dynamd */
+static int ptrx, ptry, ptrknown; /* pointer position as of the last event that reported it */
 static Cur *cursor[CurLast];
 static Clr **scheme;
 static Display *dpy;
 static Drw *drw;
 static Monitor *mons, *selmon;
 static Window root, wmcheckwin;
+static Window outlinewin[4]; /* edges of the move/resize outline */
+static int syncext, syncevbase; /* SYNC extension, for paced resizing */
 static xcb_connection_t *xcon;
+static Display *rdpy;  /* render thread connection, NULL draws on the event thread */
+static Drw *rdrw;
+static Clr **rscheme;
+static Sprites sprites, rsprites; /* labels of drw and rdrw */
+static pthread_t renderthread;
+static pthread_mutex_t barlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t barcond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t framecond = PTHREAD_COND_INITIALIZER; /* curframe was drawn */
+static BarFrame *frames, *curframe; /* waiting and being drawn, under barlock */
+static int rendering;
+static int barshm;     /* bars are drawn by the shared memory backend of drw */
+static unsigned int nframes, nframeops, nframereqs; /* since the last reportwakeups(), under barlock */
+static Timer timers[TimerLast] = {
+    [TimerFreeze] = { 0, freezeclients },
+    [TimerSched]  = { 0, schedclients },
+    [TimerStats]  = { 0, reportwakeups },
+    [TimerDwell]  = { 0, dwellfocus },
+    [TimerConfigure] = { 0, flushconfigures },
+    [TimerPing]   = { 0, pingclients },
+};
 
 /* configuration, allows nested code to access above variables */
 #include "config.h"
@@ -367,6 +543,8 @@ struct Pertag {
 /* compile-time check if all tags fit into an unsigned int bit array. */
 struct NumTags { char limitexceeded[LENGTH(tags) > 25 ? -1 : 1]; };
 
+static int tagw[LENGTH(tags)]; /* measured once, clicks are resolved without Xft */
+
 /* dynamd will keep pid's of processes from autostart array and kill them at quit */
 static pid_t *autostart_pids;
 static size_t autostart_len;
@@ -463,7 +641,8 @@ void centeredmaster(Monitor *m) {
 
 void monocle(Monitor *m) {
     unsigned int n = 0;
-    Client *c;
+    int w, h;
+    Client *c, *f = toptiled(m, 0);
 
     for (c = m -> clients; c; c = c -> next) {
          if (ISVISIBLE(c)) { n++; }
@@ -474,7 +653,14 @@ void monocle(Monitor *m) {
     }
 
     for (c = nexttiled(m -> clients); c; c = nexttiled(c -> next)) {
-        resize(c, m -> wx, m -> wy, m -> ww - 2 * c -> bw, m -> wh - 2 * c -> bw, 0);
+        w = m -> ww - 2 * c -> bw;
+        h = m -> wh - 2 * c -> bw;
+
+        if (c != f && isoccluded(c, m -> wx, m -> wy, w, h)) {
+            c -> isdeferred = 1;
+        } else {
+            resize(c, m -> wx, m -> wy, w, h, 0);
+        }
     }
 }
 
@@ -524,12 +710,13 @@ void deck(Monitor *m) {
     int sx = 0, sy = 0, sh = 0, sw = 0;
     float mfacts, sfacts;
     int mrest, srest;
-    Client *c;
+    Client *c, *f;
 
     getgaps(m, &oh, &ov, &ih, &iv, &n);
     
     if (n == 0) { return; }
 
+    f = toptiled(m, m -> nmaster);
     sx = mx = m -> wx + ov;
     sy = my = m -> wy + oh;
     sh = mh = m -> wh - 2 * oh - ih * (MIN(n, m -> nmaster) - 1);
@@ -553,6 +740,8 @@ void deck(Monitor *m) {
         if (i < m -> nmaster) {
             resize(c, mx, my, mw - (2 * c -> bw), (mh / mfacts) + (i < mrest ? 1 : 0) - (2 * c -> bw), 0);
             my += HEIGHT(c) + ih;
+        } else if (c != f && isoccluded(c, sx, sy, sw - (2 * c -> bw), sh - (2 * c -> bw))) {
+            c -> isdeferred = 1;
         } else {
             resize(c, sx, sy, sw - (2 * c -> bw), sh - (2 * c -> bw), 0);
         }
@@ -1009,6 +1198,24 @@ void getfacts(Monitor *m, int msize, int ssize, float *mf,
 }
 
 
+/* Topmost tiled client in stacking order, ignoring the first skip tiled
+ * clients (the masters of deck). In monocle and deck it covers the others. */
+Client *toptiled(Monitor *m, unsigned int skip) {
+    unsigned int i;
+    Client *c, *t;
+
+    for (c = m -> stack; c; c = c -> snext) {
+        if (c -> isfloating || !ISVISIBLE(c)) { continue; }
+
+        for (i = 0, t = nexttiled(m -> clients); t && t != c && i < skip; t = nexttiled(t -> next), i++);
+
+        if (t != c || i >= skip) { return c; }
+    }
+
+    return NULL;
+}
+
+
 /* execute command from autostart array */
 static void autostart_exec() {
     const char *const *p;
@@ -1037,19 +1244,30 @@ static void autostart_exec() {
 
 
 /* function implementations */
-void applyrules(Client *c) {
-    const char *class, *instance;
+/* match c against the rules, cls is its WM_CLASS property */
+void applyrules(Client *c, xcb_get_property_reply_t *cls) {
+    const char *class = broken, *instance = broken;
+    char buf[256];
     unsigned int i;
+    int len;
     const Rule *r;
     Monitor *m;
-    XClassHint ch = { NULL, NULL };
+
+    /* WM_CLASS holds the instance and the class, each NUL terminated */
+    if (cls && cls -> format == 8 && (len = xcb_get_property_value_length(cls)) > 0) {
+        len = MIN(len, (int)sizeof buf - 1);
+        memcpy(buf, xcb_get_property_value(cls), len);
+        buf[len] = '\0';
+        instance = buf;
+
+        if ((int)strlen(buf) + 1 < len) {
+            class = buf + strlen(buf) + 1;
+        }
+    }
 
     /* rule matching */
     c -> isfloating = 0;
     c -> tags = 0;
-    XGetClassHint(dpy, c -> win, &ch);
-    class    = ch.res_class ? ch.res_class : broken;
-    instance = ch.res_name  ? ch.res_name  : broken;
 
     for (i = 0; i < LENGTH(rules); i++) {
         r = &rules[i];
@@ -1060,6 +1278,9 @@ void applyrules(Client *c) {
 
             c -> isterminal = r -> isterminal;
             c -> noswallow  = r -> noswallow;
+            c -> iconify   |= r -> iconify;
+            c -> freeze     = r -> freeze;
+            c -> outline    = r -> outline;
             c -> isfloating = r -> isfloating;
             c -> tags |= r -> tags;
 
@@ -1069,9 +1290,6 @@ void applyrules(Client *c) {
         }
     }
 
-    if (ch.res_class) { XFree(ch.res_class); }
-    if (ch.res_name) { XFree(ch.res_name); }
-    
     c -> tags = c -> tags & TAGMASK ? c -> tags & TAGMASK : c -> mon -> tagset[c -> mon -> seltags];
 }
 
@@ -1154,6 +1372,13 @@ int applysizehints(Client *c, int *x, int *y,
 }
 
 
+void armtimer(int t, long at) {
+    if (!timers[t].at || at < timers[t].at) {
+        timers[t].at = at;
+    }
+}
+
+
 void arrange(Monitor *m) {
     if (m) {
         showhide(m -> stack);
@@ -1165,10 +1390,13 @@ void arrange(Monitor *m) {
 
     if (m) {
         arrangemon(m);
+        showiconic(m);
         restack(m);
     } else {
         for (m = mons; m; m = m -> next) {
             arrangemon(m);
+            showiconic(m);
+            updatecovered(m);
         }
     }
 }
@@ -1186,54 +1414,74 @@ void arrangemon(Monitor *m) {
 
 
 void attach(Client *c) {
-    c -> next = c -> mon -> clients;
-    c -> mon -> clients = c;
+    attachbefore(c, c -> mon -> clients);
+}
+
+
+/* insert c in front of at, at == NULL appends */
+void attachbefore(Client *c, Client *at) {
+    c -> next = at;
+    c -> prev = at ? at -> prev : c -> mon -> ctail;
+
+    if (c -> prev) {
+        c -> prev -> next = c;
+    } else {
+        c -> mon -> clients = c;
+    }
+
+    if (at) {
+        at -> prev = c;
+    } else {
+        c -> mon -> ctail = c;
+    }
 }
 
 
 void attachstack(Client *c) {
+    c -> sprev = NULL;
     c -> snext = c -> mon -> stack;
+
+    if (c -> snext) { c -> snext -> sprev = c; }
+
     c -> mon -> stack = c;
 }
 
 
 void attachbottom(Client *c) {
-    Client **tc;
-    c -> next = NULL;
-
-    for (tc = &c -> mon -> clients; *tc; tc = &(*tc) -> next);
-
-    *tc = c;
+    attachbefore(c, NULL);
 }
 
 
-void swallow(Client *p, Client *c) {
-
-    if (c -> noswallow || c -> isterminal) { return; }
-    if (c -> noswallow && !1 && c -> isfloating) { return; }
+/* Put the new, not yet mapped window of c in place of terminal p. Returns 0
+ * if c has to be managed on its own. */
+int swallow(Client *p, Client *c) {
 
-    detach(c);
-    detachstack(c);
+    if (c -> noswallow || c -> isterminal) { return 0; }
+    if (c -> noswallow && !1 && c -> isfloating) { return 0; }
 
-    setclientstate(c, WithdrawnState);
     XUnmapWindow(dpy, p -> win);
+    setclientstate(p, IconicState);
 
     p -> swallowing = c;
     c -> mon = p -> mon;
 
-    Window w = p -> win;
-    p -> win = c -> win;
-    c -> win = w;
+    swapwindows(p, c);
+    c -> isiconic = 1; /* the terminal window, unmapped above */
     updatetitle(p);
-    XMoveResizeWindow(dpy, p -> win, p -> x, p -> y, p -> w, p -> h);
+
+    /* one configure into the terminal's slot, then the first map */
+    resizeclient(p, p -> x, p -> y, p -> w, p -> h);
+    setclientstate(p, NormalState);
+    XMapWindow(dpy, p -> win);
     arrange(p -> mon);
-    configure(p);
     updateclientlist();
+
+    return 1;
 }
 
 
 void unswallow(Client *c) {
-    c -> win = c -> swallowing -> win;
+    swapwindows(c, c -> swallowing);
 
     free(c -> swallowing);
     c -> swallowing = NULL;
@@ -1241,10 +1489,8 @@ void unswallow(Client *c) {
     /* unfullscreen the client */
     setfullscreen(c, 0);
     updatetitle(c);
-    arrange(c -> mon);
-    XMapWindow(dpy, c -> win);
+    arrange(c -> mon); /* maps the terminal again through showiconic() */
     XMoveResizeWindow(dpy, c -> win, c -> x, c -> y, c -> w, c -> h);
-    setclientstate(c, NormalState);
     focus(NULL);
     arrange(c -> mon);
 }
@@ -1258,6 +1504,7 @@ void buttonpress(XEvent *e) {
     XButtonPressedEvent *ev = &e -> xbutton;
 
     click = ClkRootWin;
+    setptr(ev -> x_root, ev -> y_root);
 
     /* focus monitor if necessary */
     if ((m = wintomon(ev -> window)) && m != selmon) {
@@ -1273,7 +1520,9 @@ void buttonpress(XEvent *e) {
             occ |= c -> tags == 255 ? 0 : c -> tags;
         }
 
-        x += blw;
+        pthread_mutex_lock(&barlock);
+        x += m -> ltw;
+        pthread_mutex_unlock(&barlock);
 
         if (ev -> x < x) {
             click = ClkLtSymbol;
@@ -1283,7 +1532,7 @@ void buttonpress(XEvent *e) {
                 if (!(occ & 1 << i || m -> tagset[m -> seltags] & 1 << i)) {
                     continue;
                 }
-                x += TEXTW(tags[i]);
+                x += tagw[i];
             } while (ev -> x >= x && ++i < LENGTH(tags));
 
             if (i < LENGTH(tags)) {
@@ -1297,6 +1546,7 @@ void buttonpress(XEvent *e) {
 
         if (ev -> window == selmon -> tabwin) {
             i = 0; x = 0;
+            pthread_mutex_lock(&barlock);
 
             for (c = selmon -> clients; c; c = c -> next) {
                 if (!ISVISIBLE(c)) { continue; }
@@ -1308,6 +1558,8 @@ void buttonpress(XEvent *e) {
                 if (i >= m -> ntabs) { break; }
         }
 
+        pthread_mutex_unlock(&barlock);
+
         if (c) {
             click = ClkTabBar;
             arg.ui = i;
@@ -1330,6 +1582,42 @@ void buttonpress(XEvent *e) {
 }
 
 
+/* Render every tag label in each scheme and urgency, and every layout
+ * symbol, once into a pixmap, so drawing the bar only copies from it. */
+void buildsprites(Drw *drw, Clr **scheme, Sprites *sp) {
+    int i, k, n, x = 0;
+
+    for (n = 0; layouts[n].symbol; n++);
+
+    n += LENGTH(tags) * 4;
+    sp -> x = ecalloc(n, sizeof(int));
+    sp -> w = ecalloc(n, sizeof(int));
+
+    for (k = 0; k < n; k++) {
+        i = k < LENGTH(tags) * 4 ? k / 4 : k - LENGTH(tags) * 4;
+        sp -> w[k] = k < LENGTH(tags) * 4 ? tagw[i] : TEXTW(layouts[i].symbol);
+        sp -> x[k] = x;
+        x += sp -> w[k];
+    }
+
+    sp -> pm = XCreatePixmap(drw -> dpy, drw -> root, x, bh, DefaultDepth(drw -> dpy, drw -> screen));
+
+    for (k = 0; k < n; k++) {
+        if (k < LENGTH(tags) * 4) {
+            i = k / 4;
+            drw_setscheme(drw, scheme[k & 2 ? SchemeSel : SchemeNorm]);
+            drw_text(drw, 0, 0, sp -> w[k], bh, lrpad / 2, tags[i], k & 1);
+        } else {
+            i = k - LENGTH(tags) * 4;
+            drw_setscheme(drw, scheme[SchemeNorm]);
+            drw_text(drw, 0, 0, sp -> w[k], bh, lrpad / 2, layouts[i].symbol, 0);
+        }
+
+        XCopyArea(drw -> dpy, drw -> drawable, sp -> pm, drw -> gc, 0, 0, sp -> w[k], bh, sp -> x[k], 0);
+    }
+}
+
+
 void checkotherwm() {
     xerrorxlib = XSetErrorHandler(xerrorstart);
     /* this causes an error if some other window manager is running */
@@ -1351,16 +1639,29 @@ void cleanup() {
 
     for (m = mons; m; m = m -> next) {
         while (m -> stack) {
+            /* view() only showed selmon, a window left unmapped would be
+             * withdrawn and not found by the next scan() */
+            seticonic(m -> stack, 0);
             unmanage(m -> stack, 0);
         }
     }
 
+    /* a last try, nothing retries after exit */
+    for (i = 0; i < LENGTH(unthawed); i++) {
+        if (unthawed[i].pid) { thaw(unthawed[i].pid, unthawed[i].how); }
+    }
+
     XUngrabKey(dpy, AnyKey, AnyModifier, root);
 
+    /* before the bars go, the thread would paint them */
+    stoprender();
+
     while (mons) {
         cleanupmon(mons);
     }
 
+    freesprites(drw, &sprites);
+
     for (i = 0; i < CurLast; i++) {
         drw_cur_free(drw, cursor[i]);
     }
@@ -1369,6 +1670,10 @@ void cleanup() {
         free(scheme[i]);
     }
 
+    for (i = 0; i < LENGTH(outlinewin); i++) {
+        if (outlinewin[i]) { XDestroyWindow(dpy, outlinewin[i]); }
+    }
+
     XDestroyWindow(dpy, wmcheckwin);
     drw_free(drw);
     XSync(dpy, False);
@@ -1379,6 +1684,7 @@ void cleanup() {
 
 void cleanupmon(Monitor *mon) {
     Monitor *m;
+    BarFrame **p, *f;
 
     if (mon == mons) {
         mons = mons -> next;
@@ -1387,10 +1693,29 @@ void cleanupmon(Monitor *mon) {
         m -> next = mon -> next;
     }
 
+    /* nothing may paint the bars once they are destroyed, nor use mon */
+    pthread_mutex_lock(&barlock);
+
+    for (p = &frames; (f = *p);) {
+        if (f -> win == mon -> barwin || f -> win == mon -> tabwin) {
+            *p = f -> next;
+            free(f);
+        } else {
+            p = &f -> next;
+        }
+    }
+
+    while (curframe && (curframe -> win == mon -> barwin || curframe -> win == mon -> tabwin)) {
+        pthread_cond_wait(&framecond, &barlock);
+    }
+
+    pthread_mutex_unlock(&barlock);
+
     XUnmapWindow(dpy, mon -> barwin);
     XDestroyWindow(dpy, mon -> barwin);
     XUnmapWindow(dpy, mon -> tabwin);
     XDestroyWindow(dpy, mon -> tabwin);
+    XDestroyWindow(dpy, mon -> inputwin);
     free(mon);
 }
 
@@ -1399,6 +1724,12 @@ void clientmessage(XEvent *e) {
     XClientMessageEvent *cme = &e -> xclient;
     Client *c = wintoclient(cme -> window);
 
+    /* a _NET_WM_PING answer comes back on root */
+    if (cme -> message_type == wmatom[WMProtocols] && (Atom)cme -> data.l[0] == netatom[NetWMPing]) {
+        if ((c = wintoclient(cme -> data.l[2]))) { pong(c, cme -> data.l[1]); }
+        return;
+    }
+
     if (!c) { return; }
 
     if (cme -> message_type == netatom[NetWMState]) {
@@ -1417,6 +1748,8 @@ void clientmessage(XEvent *e) {
 void configure(Client *c) {
     XConfigureEvent ce;
 
+    if (c -> isunresponsive) { return; }
+
     ce.type = ConfigureNotify;
     ce.display = dpy;
     ce.event = c -> win;
@@ -1456,10 +1789,13 @@ void configurenotify(XEvent *e) {
                 }
 
                 XMoveResizeWindow(dpy, m -> barwin, m -> wx, m -> by, m -> ww, bh);
+                XMoveResizeWindow(dpy, m -> inputwin, m -> mx, m -> my, m -> mw, m -> mh);
             }
 
             focus(NULL);
             arrange(NULL);
+            drawbars();
+            drawtabs();
         }
     }
 }
@@ -1467,55 +1803,23 @@ void configurenotify(XEvent *e) {
 
 void configurerequest(XEvent *e) {
     Client *c;
-    Monitor *m;
     XConfigureRequestEvent *ev = &e -> xconfigurerequest;
+    XEvent next;
     XWindowChanges wc;
 
     if ((c = wintoclient(ev -> window))) {
-        if (ev -> value_mask & CWBorderWidth) {
-            c -> bw = ev -> border_width;
-        } else if (c -> isfloating || 
-                   !selmon -> lt[selmon -> sellt] -> arrange) {
-
-            m = c -> mon;
-
-            if (ev -> value_mask & CWX) {
-                c -> oldx = c -> x;
-                c -> x = m -> mx + ev -> x;
-            }
-
-            if (ev -> value_mask & CWY) {
-                c -> oldy = c -> y;
-                c -> y = m -> my + ev -> y;
-            }
-
-            if (ev -> value_mask & CWWidth) {
-                c -> oldw = c -> w;
-                c -> w = ev -> width;
-            }
-
-            if (ev -> value_mask & CWHeight) {
-                c -> oldh = c -> h;
-                c -> h = ev -> height;
-            }
-
-            if ((c -> x + c -> w) > m -> mx + m -> mw && c -> isfloating) {
-                c -> x = m -> mx + (m -> mw / 2 - WIDTH(c) / 2); /* center in x direction */
-            }
-
-            if ((c -> y + c -> h) > m -> my + m -> mh && c -> isfloating) {
-                c -> y = m -> my + (m -> mh / 2 - HEIGHT(c) / 2); /* center in y direction */
-            }
+        queueconfigure(c, ev);
 
-            if ((ev -> value_mask & (CWX|CWY)) && !(ev -> value_mask & (CWWidth|CWHeight))) {
-                configure(c);
-            }
+        /* fold in the requests for this window that are already queued */
+        while (XCheckTypedWindowEvent(dpy, ev -> window, ConfigureRequest, &next)) {
+            queueconfigure(c, &next.xconfigurerequest);
+        }
 
-            if (ISVISIBLE(c)) {
-                XMoveResizeWindow(dpy, c -> win, c -> x, c -> y, c -> w, c -> h);
-            }
-        } else
-            configure(c);
+        if (takecfgtoken(c)) {
+            applyconfigure(c);
+        } else {
+            armtimer(TimerConfigure, nowms() + 1000 / cfgrate);
+        }
     } else {
         wc.x = ev -> x;
         wc.y = ev -> y;
@@ -1527,8 +1831,127 @@ void configurerequest(XEvent *e) {
 
         XConfigureWindow(dpy, ev -> window, ev -> value_mask, &wc);
     }
+}
+
+
+/* merge ev into the pending request of c, the last value of each field wins */
+void queueconfigure(Client *c, XConfigureRequestEvent *ev) {
+    XConfigureRequestEvent *p = &c -> cfgreq;
+
+    c -> ncfg++;
+
+    /* border width requests are handled on their own, never merged with geometry */
+    if (c -> cfgpending && ((p -> value_mask ^ ev -> value_mask) & CWBorderWidth)) {
+        applyconfigure(c);
+    }
 
-    XSync(dpy, False);
+    if (!c -> cfgpending) {
+        *p = *ev;
+        c -> cfgpending = 1;
+        return;
+    }
+
+    if (ev -> value_mask & CWX) { p -> x = ev -> x; }
+    if (ev -> value_mask & CWY) { p -> y = ev -> y; }
+    if (ev -> value_mask & CWWidth) { p -> width = ev -> width; }
+    if (ev -> value_mask & CWHeight) { p -> height = ev -> height; }
+    if (ev -> value_mask & CWBorderWidth) { p -> border_width = ev -> border_width; }
+    if (ev -> value_mask & CWSibling) { p -> above = ev -> above; }
+    if (ev -> value_mask & CWStackMode) { p -> detail = ev -> detail; }
+
+    p -> value_mask |= ev -> value_mask;
+}
+
+
+int takecfgtoken(Client *c) {
+    long t = nowms();
+
+    if (!cfgrate) { return 1; }
+
+    c -> cfgtokens = MIN(cfgburst, c -> cfgtokens + (t - c -> cfgstamp) * cfgrate / 1000.0);
+    c -> cfgstamp = t;
+
+    if (c -> cfgtokens < 1) { return 0; }
+
+    c -> cfgtokens -= 1;
+
+    return 1;
+}
+
+
+/* apply the pending ConfigureRequests the rate limit held back */
+void flushconfigures() {
+    Client *c;
+    Monitor *m;
+    int held = 0;
+
+    for (m = mons; m; m = m -> next) {
+        for (c = m -> clients; c; c = c -> next) {
+            if (!c -> cfgpending) { continue; }
+
+            if (takecfgtoken(c)) {
+                applyconfigure(c);
+            } else {
+                held = 1;
+            }
+        }
+    }
+
+    if (held) { armtimer(TimerConfigure, nowms() + 1000 / cfgrate); }
+}
+
+
+void applyconfigure(Client *c) {
+    Monitor *m;
+    XConfigureRequestEvent *ev = &c -> cfgreq;
+
+    c -> cfgpending = 0;
+    c -> ncfgapplied++;
+
+    if (ev -> value_mask & CWBorderWidth) {
+        c -> bw = ev -> border_width;
+    } else if (c -> isfloating || 
+               !selmon -> lt[selmon -> sellt] -> arrange) {
+
+        m = c -> mon;
+
+        if (ev -> value_mask & CWX) {
+            c -> oldx = c -> x;
+            c -> x = m -> mx + ev -> x;
+        }
+
+        if (ev -> value_mask & CWY) {
+            c -> oldy = c -> y;
+            c -> y = m -> my + ev -> y;
+        }
+
+        if (ev -> value_mask & CWWidth) {
+            c -> oldw = c -> w;
+            c -> w = ev -> width;
+        }
+
+        if (ev -> value_mask & CWHeight) {
+            c -> oldh = c -> h;
+            c -> h = ev -> height;
+        }
+
+        if ((c -> x + c -> w) > m -> mx + m -> mw && c -> isfloating) {
+            c -> x = m -> mx + (m -> mw / 2 - WIDTH(c) / 2); /* center in x direction */
+        }
+
+        if ((c -> y + c -> h) > m -> my + m -> mh && c -> isfloating) {
+            c -> y = m -> my + (m -> mh / 2 - HEIGHT(c) / 2); /* center in y direction */
+        }
+
+        if ((ev -> value_mask & (CWX|CWY)) && !(ev -> value_mask & (CWWidth|CWHeight))) {
+            configure(c);
+        }
+
+        if (ISVISIBLE(c)) {
+            XMoveResizeWindow(dpy, c -> win, c -> x, c -> y, c -> w, c -> h);
+        }
+    } else
+        configure(c);
 }
 
 
@@ -1608,20 +2031,34 @@ void destroynotify(XEvent *e) {
 
 
 void detach(Client *c) {
-    Client **tc;
+    if (c -> prev) {
+        c -> prev -> next = c -> next;
+    } else {
+        c -> mon -> clients = c -> next;
+    }
 
-    for (tc = &c -> mon -> clients; *tc && *tc != c; tc = &(*tc) -> next);
+    if (c -> next) {
+        c -> next -> prev = c -> prev;
+    } else {
+        c -> mon -> ctail = c -> prev;
+    }
 
-    *tc = c -> next;
+    c -> next = c -> prev = NULL;
 }
 
 
 void detachstack(Client *c) {
-    Client **tc, *t;
+    Client *t;
 
-    for (tc = &c -> mon -> stack; *tc && *tc != c; tc = &(*tc) -> snext);
-    
-    *tc = c -> snext;
+    if (c -> sprev) {
+        c -> sprev -> snext = c -> snext;
+    } else {
+        c -> mon -> stack = c -> snext;
+    }
+
+    if (c -> snext) { c -> snext -> sprev = c -> sprev; }
+
+    c -> snext = c -> sprev = NULL;
 
     if (c == c -> mon -> sel) {
         for (t = c -> mon -> stack; t && !ISVISIBLE(t); t = t -> snext);
@@ -1648,45 +2085,26 @@ Monitor *dirtomon(int dir) {
 }
 
 
+/* Snapshot what the bar of m shows. Drawing it, with text shaping and font
+ * fallback, is left to the render thread. */
 void drawbar(Monitor *m) {
-    int x, w, sw = 0;
-    unsigned int i, occ = 0, urg = 0;
+    BarFrame *f = ecalloc(1, sizeof(BarFrame));
     Client *c;
 
-    /* draw status first so it can be overdrawn by tags later */
-    if (m == selmon || 1) { /* status is only drawn on selected monitor */
-        drw_setscheme(drw, scheme[SchemeNorm]);
-        sw = TEXTW(stext) - lrpad + 2; /* 2px right padding */
-        drw_text(drw, m -> ww - sw, 0, sw, bh, 0, stext, 0);
-    }
-
     for (c = m -> clients; c; c = c -> next) {
-        occ |= c -> tags == 255 ? 0 : c -> tags;
-        if (c -> isurgent) { urg |= c -> tags; }
+        f -> occ |= c -> tags == 255 ? 0 : c -> tags;
+        if (c -> isurgent) { f -> urg |= c -> tags; }
     }
 
-    x = 0;
-    w = blw = TEXTW(m -> ltsymbol);
-    drw_setscheme(drw, scheme[SchemeNorm]);
-    x = drw_text(drw, x, 0, w, bh, lrpad / 2, m -> ltsymbol, 0);
-
-    for (i = 0; i < LENGTH(tags); i++) {
-        /* do not draw vacant tags */
-        if (!(occ & 1 << i || m -> tagset[m -> seltags] & 1 << i)) { continue; }
-
-        w = TEXTW(tags[i]);
-        drw_setscheme(drw, scheme[m -> tagset[m -> seltags] & 1 << i ? SchemeSel : SchemeNorm]);
-        drw_text(drw, x, 0, w, bh, lrpad / 2, tags[i], urg & 1 << i);
-
-        x += w;
-    }
-    
-    if ((w = m -> ww - sw - x) > bh) {
-        drw_setscheme(drw, scheme[SchemeNorm]);
-        drw_rect(drw, x, 0, w, bh, 1, 1);
-    }
+    f -> win = m -> barwin;
+    f -> m = m;
+    f -> ww = m -> ww;
+    f -> tagset = m -> tagset[m -> seltags];
+    f -> shm = barshm;
+    memcpy(f -> ltsymbol, m -> ltsymbol, sizeof f -> ltsymbol);
+    memcpy(f -> stext, stext, sizeof f -> stext);
 
-    drw_map(drw, m -> barwin, 0, 0, m -> ww, bh);
+    postframe(f);
 }
 
 
@@ -1713,93 +2131,63 @@ static int cmpint(const void *p1, const void *p2) {
 
 
 void drawtab(Monitor *m) {
+    BarFrame *f = ecalloc(1, sizeof(BarFrame));
     Client *c;
-    int i;
-    int sorted_label_widths[25];
-    int tot_width = 0;
-    int maxsize = bh;
-    int x = 0, w = 0;
 
-    /* Calculates number of labels and their width */
-    m -> ntabs = 0;
-
-    for (c = m -> clients; c; c = c -> next) {
-        if (!ISVISIBLE(c)) {
-            continue;
-        }
-
-        m -> tab_widths[m -> ntabs] = TEXTW(c -> name);
-        tot_width += m -> tab_widths[m -> ntabs];
-        ++m -> ntabs;
+    for (c = m -> clients; c && f -> ntabs < LENGTH(f -> names); c = c -> next) {
+        if (!ISVISIBLE(c)) { continue; }
 
-        if (m -> ntabs >= 25) {
-            break;
-        }
+        f -> tabscheme[f -> ntabs] = c -> isunresponsive ? SchemeHung : (c == m -> sel) ? SchemeSel : SchemeNorm;
+        memcpy(f -> names[f -> ntabs], c -> name, sizeof f -> names[0]);
+        f -> ntabs++;
     }
 
-    if (tot_width > m -> ww) { //not enough space to display the labels, they need to be truncated
-      memcpy(sorted_label_widths, m -> tab_widths, sizeof(int) * m -> ntabs);
-      qsort(sorted_label_widths, m -> ntabs, sizeof(int), cmpint);
+    f -> win = m -> tabwin;
+    f -> m = m;
+    f -> istab = 1;
+    f -> ww = m -> ww;
+    f -> shm = barshm;
 
-      for (i = 0; i < m -> ntabs; ++i) {
-        if (tot_width + (m -> ntabs - i) * sorted_label_widths[i] > m -> ww) {
-            break;
-        }
+    postframe(f);
+}
 
-        tot_width += sorted_label_widths[i];
-      }
-      maxsize = (m -> ww - tot_width) / (m -> ntabs - i);
-    } else {
-      maxsize = m -> ww;
-    }
 
-    i = 0;
+void dwellfocus() {
+    enterwin(dwellwin);
+}
 
-    for (c = m -> clients; c; c = c -> next) {
-      if (!ISVISIBLE(c)) { continue; }
 
-      if (i >= m -> ntabs) { break; }
+void enternotify(XEvent *e) {
+    XCrossingEvent *ev = &e -> xcrossing;
 
-      if (m -> tab_widths[i] >  maxsize) {
-          m -> tab_widths[i] = maxsize;
-      }
+    setptr(ev -> x_root, ev -> y_root);
 
-      w = m -> tab_widths[i];
+    if (ev -> serial < enterseq) { return; }
 
-      drw_setscheme(drw, scheme[(c == m -> sel) ? SchemeSel : SchemeNorm]);
-      drw_text(drw, x, 0, w, th, 0, c -> name, 0);
+    if ((ev -> mode != NotifyNormal || 
+        ev -> detail == NotifyInferior) && 
+        ev -> window != root) {
+            return;
+        }
 
-      x += w;
-      ++i;
+    /* windows swept over on the way are never focused */
+    if (focusdwell) {
+        dwellwin = ev -> window;
+        timers[TimerDwell].at = nowms() + focusdwell;
+        return;
     }
 
-    drw_setscheme(drw, scheme[SchemeNorm]);
-
-    /* cleans interspace between window names and current viewed tag label */
-    w = m -> ww - x;
-    drw_text(drw, x, 0, w, th, 0, "", 0);
-
-    /* view info */
-    x += w;
-
-    drw_text(drw, x, 0, 0, th, 0, 0, 0);
-    drw_map(drw, m -> tabwin, 0, 0, m -> ww, th);
+    enterwin(ev -> window);
 }
 
 
-void enternotify(XEvent *e) {
+/* focus follows the pointer into w */
+void enterwin(Window w) {
     Client *c;
     Monitor *m;
-    XCrossingEvent *ev = &e -> xcrossing;
-
-    if ((ev -> mode != NotifyNormal || 
-        ev -> detail == NotifyInferior) && 
-        ev -> window != root) {
-            return;
-        }
 
-    c = wintoclient(ev -> window);
-    m = c ? c -> mon : wintomon(ev -> window);
+    c = wintoclient(w);
+    m = c ? c -> mon : wintomon(w);
 
     if (m != selmon) {
         unfocus(selmon -> sel, 1);
@@ -1810,6 +2198,30 @@ void enternotify(XEvent *e) {
 }
 
 
+/* show the frame of a pending move/resize, without touching the client */
+void drawoutline(int x, int y, int w, int h) {
+    int i, t = 2;
+    XRectangle r[4] = {
+        { x, y, w, t }, { x, y + h - t, w, t },
+        { x, y, t, h }, { x + w - t, y, t, h },
+    };
+    XSetWindowAttributes wa = {
+        .override_redirect = True,
+        .background_pixel = scheme[SchemeSel][ColBorder].pixel,
+    };
+
+    for (i = 0; i < 4; i++) {
+        if (!outlinewin[i]) {
+            outlinewin[i] = XCreateWindow(dpy, root, 0, 0, 1, 1, 0, CopyFromParent,
+                    InputOutput, CopyFromParent, CWOverrideRedirect|CWBackPixel, &wa);
+        }
+
+        XMoveResizeWindow(dpy, outlinewin[i], r[i].x, r[i].y, MAX(r[i].width, 1), MAX(r[i].height, 1));
+        XMapRaised(dpy, outlinewin[i]);
+    }
+}
+
+
 void expose(XEvent *e) {
     Monitor *m;
     XExposeEvent *ev = &e -> xexpose;
@@ -1821,7 +2233,16 @@ void expose(XEvent *e) {
 }
 
 
-void focus(Client *c) {
+void freesprites(Drw *drw, Sprites *sp) {
+    XFreePixmap(drw -> dpy, sp -> pm);
+    free(sp -> x);
+    free(sp -> w);
+}
+
+
+void focus(Client *c) {
+    Monitor *m = selmon;
+
     if (!c || !ISVISIBLE(c)) {
         for (c = selmon -> stack; c && !ISVISIBLE(c); c = c -> snext);
     }
@@ -1849,8 +2270,17 @@ void focus(Client *c) {
 
     selmon -> sel = c;
 
-    drawbars();
-    drawtabs();
+    /* reprioritise once focus has settled */
+    if (schedhints) { timers[TimerSched].at = nowms() + schedhold; }
+
+    /* only the selection and urgency of these monitors changed */
+    drawbar(selmon);
+    drawtab(selmon);
+
+    if (m != selmon) {
+        drawbar(m);
+        drawtab(m);
+    }
 }
 
 
@@ -1883,7 +2313,7 @@ void focusmon(const Arg *arg) {
 
 
 void focusstack(const Arg *arg) {
-    Client *c = NULL, *i;
+    Client *c = NULL;
 
     if (!selmon -> sel) {
         return;
@@ -1896,18 +2326,10 @@ void focusstack(const Arg *arg) {
             for (c = selmon -> clients; c && !ISVISIBLE(c); c = c -> next);
         }
     } else {
-        for (i = selmon -> clients; i != selmon -> sel; i = i -> next) {
-            if (ISVISIBLE(i)) {
-                c = i;
-            }
-        }
+        for (c = selmon -> sel -> prev; c && !ISVISIBLE(c); c = c -> prev);
 
         if (!c) {
-            for (; i; i = i -> next) {
-                if (ISVISIBLE(i)) {
-                    c = i;
-                }
-            }
+            for (c = selmon -> ctail; c && !ISVISIBLE(c); c = c -> prev);
         }
     }
 
@@ -1919,11 +2341,13 @@ void focusstack(const Arg *arg) {
 
 
 void movestack(const Arg *arg) {
-    Client *c = NULL, *p = NULL, *pc = NULL, *i;
+    Client *c = NULL, *s = selmon -> sel, *sn, *cn;
+
+    if (!s) { return; }
 
     if (arg -> i > 0) {
         /* find the client after selmon -> sel */
-        for (c = selmon -> sel -> next; c && (!ISVISIBLE(c) || c -> isfloating); c = c -> next);
+        for (c = s -> next; c && (!ISVISIBLE(c) || c -> isfloating); c = c -> next);
 
         if (!c) {
             for (c = selmon -> clients; c && (!ISVISIBLE(c) || c -> isfloating); c = c -> next);
@@ -1931,53 +2355,33 @@ void movestack(const Arg *arg) {
 
     } else {
         /* find the client before selmon->sel */
-        for (i = selmon -> clients; i != selmon -> sel; i = i -> next) {
-            if (ISVISIBLE(i) && !i -> isfloating) {
-                c = i;
-            }
-        }
-        if (!c) {
-            for (; i; i = i -> next) {
-                if (ISVISIBLE(i) && !i -> isfloating) {
-                    c = i;
-                }
-            }
-        }
-    }
-
-    /* find the client before selmon->sel and c */
-    for (i = selmon -> clients; i && (!p || !pc); i = i -> next) {
-        if (i -> next == selmon -> sel) {
-            p = i;
-        }
+        for (c = s -> prev; c && (!ISVISIBLE(c) || c -> isfloating); c = c -> prev);
 
-        if (i -> next == c) {
-            pc = i;
+        if (!c) {
+            for (c = selmon -> ctail; c && (!ISVISIBLE(c) || c -> isfloating); c = c -> prev);
         }
     }
 
-    /* swap c and selmon->sel selmon->clients in the selmon->clients list */
-    if (c && c != selmon -> sel) {
-        Client *temp = selmon -> sel -> next == c ? selmon -> sel : selmon -> sel -> next;
-        selmon -> sel -> next = c -> next == selmon -> sel ? c : c -> next;
-        c -> next = temp;
-
-        if (p && p != c) {
-            p -> next = c;
-        }
-
-        if (pc && pc != selmon -> sel) {
-            pc -> next = selmon -> sel;
-        }
+    if (!c || c == s) { return; }
 
-        if(selmon -> sel == selmon -> clients) {
-            selmon -> clients = c;
-        } else if (c == selmon -> clients) {
-            selmon -> clients = selmon -> sel;
-        }
+    /* swap c and selmon->sel in the selmon->clients list */
+    sn = s -> next;
+    cn = c -> next;
 
-        arrange(selmon);
+    if (sn == c) {
+        detach(c);
+        attachbefore(c, s);
+    } else if (cn == s) {
+        detach(s);
+        attachbefore(s, c);
+    } else {
+        detach(s);
+        attachbefore(s, cn);
+        detach(c);
+        attachbefore(c, sn);
     }
+
+    arrange(selmon);
 }
 
 
@@ -1996,23 +2400,145 @@ void focuswin(const Arg* arg) {
 }
 
 
-Atom getatomprop(Client *c, Atom prop) {
-    int di;
-    unsigned long dl;
-    unsigned char *p = NULL;
-    Atom da, atom = None;
+/* Resolve the cgroup v2 directory of pid. With dedicated set this fails
+ * unless the cgroup holds nothing but pid and its descendants. */
+int getcgroup(pid_t pid, char *path, size_t size, int dedicated) {
+    char buf[PATH_MAX];
+    FILE *f;
+    int p, ok = 1;
+
+    snprintf(buf, sizeof buf, "/proc/%u/cgroup", (unsigned)pid);
+
+    if (!(f = fopen(buf, "r"))) { return 0; }
 
-    if (XGetWindowProperty(dpy, c -> win, prop, 0L, sizeof atom, False, XA_ATOM, 
-                           &da, &di, &dl, &dl, &p) == Success && p) {
+    path[0] = '\0';
 
-        atom = *(Atom *)p;
-        XFree(p);
+    while (fgets(buf, sizeof buf, f)) {
+        if (!strncmp(buf, "0::", 3)) {
+            /* a truncated path names some other cgroup */
+            if (!strchr(buf, '\n') ||
+                (size_t)snprintf(path, size, "/sys/fs/cgroup%.*s", (int)strcspn(buf + 3, "\n"), buf + 3) >= size) {
+                path[0] = '\0';
+            }
+            break;
+        }
     }
 
+    fclose(f);
+
+    if (!path[0]) { return 0; }
+
+    if (dedicated) {
+        if ((size_t)snprintf(buf, sizeof buf, "%s/cgroup.procs", path) >= sizeof buf) { return 0; }
+
+        if (!(f = fopen(buf, "r"))) { return 0; }
+
+        while (ok && fscanf(f, "%d", &p) == 1) {
+            ok = p == pid || isdescprocess(pid, p);
+        }
+
+        fclose(f);
+    }
+
+    return ok;
+}
+
+
+/* stop the processes of Freeze clients whose grace period on a hidden tag ran out */
+void freezeclients() {
+    long t = nowms(), at, next = 0;
+    Client *c;
+    Monitor *m;
+    int i;
+
+    for (i = 0; i < LENGTH(unthawed); i++) {
+        if (!unthawed[i].pid) { continue; }
+
+        if (thaw(unthawed[i].pid, unthawed[i].how)) {
+            unthawed[i].pid = 0;
+        } else {
+            next = t + 1000;
+        }
+    }
+
+    for (m = mons; m; m = m -> next) {
+        for (c = m -> clients; c; c = c -> next) {
+            /* a thaw that failed when c was shown */
+            if (c -> isfrozen && !c -> hiddenat) {
+                setfrozen(c, 0);
+                if (c -> isfrozen) { next = next ? MIN(next, t + 1000) : t + 1000; }
+                continue;
+            }
+
+            if (!c -> freeze || !c -> hiddenat || c -> isfrozen) { continue; }
+
+            at = c -> hiddenat + freezedelay * 1000L;
+
+            if (at > t) {
+                next = next ? MIN(next, at) : at;
+            } else if (canfreeze(c)) {
+                setfrozen(c, 1);
+            }
+        }
+    }
+
+    if (next) { armtimer(TimerFreeze, next); }
+}
+
+
+/* the basic _NET_WM_SYNC_REQUEST_COUNTER of c, None without the protocol */
+XSyncCounter getsynccounter(Client *c) {
+    xcb_get_property_cookie_t pck, cck;
+    xcb_get_property_reply_t *r;
+    XSyncCounter counter = None;
+
+    if (!syncext) { return None; }
+
+    /* both requests go out before either reply is awaited */
+    pck = getprop(c -> win, wmatom[WMProtocols], XA_ATOM, 32);
+    cck = getprop(c -> win, netatom[NetWMSyncRequestCounter], XA_CARDINAL, 1);
+
+    r = propreply(pck);
+
+    if (atomsreplyhas(r, netatom[NetWMSyncRequest])) {
+        free(r);
+        r = propreply(cck);
+        counter = cardinalreply(r);
+    } else {
+        xcb_discard_reply(xcon, cck.sequence);
+    }
+
+    free(r);
+
+    return counter;
+}
+
+
+Atom getatomprop(Client *c, Atom prop) {
+    xcb_get_property_reply_t *r = propreply(getprop(c -> win, prop, XA_ATOM, 1));
+    Atom atom = atomreply(r);
+
+    free(r);
+
     return atom;
 }
 
 
+/* The pointer position without a round trip. Crossing events keep it current
+ * up to movement inside a single window, which is all warp() and wintomon()
+ * need. Only a cold cache queries the server. */
+int getptr(int *x, int *y) {
+    if (!ptrknown && getrootptr(&ptrx, &ptry)) {
+        ptrknown = 1;
+    }
+
+    *x = ptrx;
+    *y = ptry;
+
+    return ptrknown;
+}
+
+
 int getrootptr(int *x, int *y) {
     int di;
     unsigned int dui;
@@ -2023,67 +2549,129 @@ int getrootptr(int *x, int *y) {
 
 
 long getstate(Window w) {
-    int format;
+    xcb_get_property_reply_t *r = propreply(getprop(w, wmatom[WMState], wmatom[WMState], 2));
     long result = -1;
-    unsigned char *p = NULL;
-    unsigned long n, extra;
-    Atom real;
 
-    if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False, wmatom[WMState],
-                           &real, &format, &n, &extra, 
-                           (unsigned char **)&p) != Success) {
-            return -1;
+    if (r && r -> format == 32 && r -> value_len) {
+        result = *(uint32_t *)xcb_get_property_value(r);
     }
 
-    if (n != 0) { result = *p; }
-
-    XFree(p);
+    free(r);
 
     return result;
 }
 
 
 int gettextprop(Window w, Atom atom, char *text, unsigned int size) {
-    char **list = NULL;
-    int n;
-    XTextProperty name;
+    xcb_get_property_reply_t *r;
+    int ret;
 
     if (!text || size == 0) {
         return 0;
     }
 
+    /* the whole value, a multibyte encoding cut short may not convert at all */
+    r = propreply(getprop(w, atom, AnyPropertyType, UINT32_MAX / 4));
+    ret = textreply(r, text, size);
+    free(r);
+
+    return ret;
+}
+
+
+/* convert a text property to a locale string in text */
+int textprop(XTextProperty *name, char *text, unsigned int size) {
+    char **list = NULL;
+    int n;
+
     text[0] = '\0';
 
-    if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems) {
+    if (!name -> nitems) {
         return 0;
     }
 
-    if (name.encoding == XA_STRING) {
-        strncpy(text, (char *)name.value, size - 1);
+    if (name -> encoding == XA_STRING) {
+        n = MIN(name -> nitems, size - 1);
+        memcpy(text, name -> value, n);
+        text[n] = '\0';
+    } else if (name -> encoding == utf8string && name -> format == 8 &&
+               utf8copy(text, name -> value, name -> nitems, size)) {
+        /* already what drw renders, no locale conversion needed */
+        return 1;
     } else {
-        if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
+        if (XmbTextPropertyToTextList(dpy, name, &list, &n) >= Success && n > 0 && *list) {
             strncpy(text, *list, size - 1);
             XFreeStringList(list);
         }
     }
 
     text[size - 1] = '\0';
-    XFree(name.value);
+
+    return 1;
+}
+
+
+/* Copy at most size - 1 bytes of the UTF-8 string s, cut at the last
+ * complete codepoint, validating as it goes. Returns 0 on malformed input. */
+int utf8copy(char *text, const unsigned char *s, unsigned long len, unsigned int size) {
+    unsigned long i = 0, n;
+    unsigned char lo, hi;
+
+    while (i < len && s[i]) {
+        lo = 0x80, hi = 0xbf;
+
+        if (s[i] < 0x80) {
+            n = 1;
+        } else if (s[i] >= 0xc2 && s[i] <= 0xdf) {
+            n = 2;
+        } else if (s[i] >= 0xe0 && s[i] <= 0xef) {
+            n = 3;
+            if (s[i] == 0xe0) { lo = 0xa0; }
+            if (s[i] == 0xed) { hi = 0x9f; } /* surrogates */
+        } else if (s[i] >= 0xf0 && s[i] <= 0xf4) {
+            n = 4;
+            if (s[i] == 0xf0) { lo = 0x90; }
+            if (s[i] == 0xf4) { hi = 0x8f; }
+        } else {
+            return 0;
+        }
+
+        if (i + n > len) { return 0; }
+
+        if (n > 1 && (s[i + 1] < lo || s[i + 1] > hi)) { return 0; }
+
+        if (n > 2 && (s[i + 2] & 0xc0) != 0x80) { return 0; }
+
+        if (n > 3 && (s[i + 3] & 0xc0) != 0x80) { return 0; }
+
+        if (i + n > size - 1) { break; }
+
+        i += n;
+    }
+
+    memcpy(text, s, i);
+    text[i] = '\0';
 
     return 1;
 }
 
 
 void grabbuttons(Client *c, int focused) {
+    int state = focused ? GrabFocused : GrabUnfocused;
+
+    /* the grabs only depend on the focus state and the numlock mask */
+    if (c -> grabstate == state) { return; }
+
     updatenumlockmask();
 
     {
         unsigned int i, j;
         unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
 
-        XUngrabButton(dpy, AnyButton, AnyModifier, c -> win);
-
-        if (!focused) {
+        if (focused) {
+            XUngrabButton(dpy, AnyButton, AnyModifier, c -> win);
+        } else {
+            /* overrides every grab already set on the window, no ungrab needed */
             XGrabButton(dpy, AnyButton, AnyModifier, c -> win, False,
                         BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
         }
@@ -2100,6 +2688,8 @@ void grabbuttons(Client *c, int focused) {
         }
 
     }
+
+    c -> grabstate = state;
 }
 
 
@@ -2127,6 +2717,17 @@ void grabkeys() {
 }
 
 
+/* whether c lies entirely within the tiled slot x, y, w, h, so that
+ * configuring it can wait until it comes to the front */
+int isoccluded(Client *c, int x, int y, int w, int h) {
+    if (!lazyoccluded || c -> isfullscreen || c -> isnew) { return 0; }
+
+    return c -> x >= x && c -> y >= y &&
+           c -> x + c -> w + 2 * c -> curbw <= x + w + 2 * c -> bw &&
+           c -> y + c -> h + 2 * c -> curbw <= y + h + 2 * c -> bw;
+}
+
+
 static int isuniquegeom(XineramaScreenInfo *unique, size_t n, 
                         XineramaScreenInfo *info) {
 
@@ -2143,12 +2744,38 @@ static int isuniquegeom(XineramaScreenInfo *unique, size_t n,
 }
 
 
+/* the events movemouse() and resizemouse() handle while they hold the pointer */
+Bool isdragevent(Display *d, XEvent *ev, XPointer arg) {
+    switch (ev -> type) {
+        case ButtonPress:
+        case ButtonRelease:
+        case MotionNotify:
+        case Expose:
+        case ConfigureRequest:
+        case MapRequest:
+            return True;
+    }
+
+    return syncext && ev -> type == syncevbase + XSyncAlarmNotify;
+}
+
+
+/* Ignore the crossing events caused by the requests sent so far. The NoOp
+ * bumps the serial, so crossings the user causes afterwards are kept. */
+void ignoreenters() {
+    enterseq = NextRequest(dpy);
+    XNoOp(dpy);
+    timers[TimerDwell].at = 0;
+}
+
+
 void keypress(XEvent *e) {
     unsigned int i;
     KeySym keysym;
     XKeyEvent *ev;
 
     ev = &e -> xkey;
+    setptr(ev -> x_root, ev -> y_root);
 
     /* 'XKeycodeToKeysym' is deprecated. It's harmless, safely can be ignored. */
     #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -2179,14 +2806,30 @@ void killclient(const Arg *arg) {
 }
 
 
-void manage(Window w, XWindowAttributes *wa) {
+void manage(Window w, XWindowAttributes *wa, const WinProps *wp) {
     Client *c, *t = NULL, *term = NULL;
     Window trans = None;
     XWindowChanges wc;
+    XSizeHints size;
+    XWMHints wmh;
+    xcb_get_property_reply_t *r[PropLast];
+    int i;
+
+    if (ismonwin(w)) {
+        discardprops(wp);
+        return;
+    }
+
+    /* the requests are all in flight, so this waits about one round trip */
+    for (i = 0; i < PropLast; i++) {
+        r[i] = propreply(wp -> prop[i]);
+    }
 
     c = ecalloc(1, sizeof(Client));
     c -> win = w;
-    c -> pid = winpid(w);
+    c -> pid = pidreply(wp -> pid);
+    c -> iconify = iconifyhidden;
+    c -> isnew = 1;
 
     /* geometry */
     c -> x = c -> oldx = wa -> x;
@@ -2195,13 +2838,22 @@ void manage(Window w, XWindowAttributes *wa) {
     c -> h = c -> oldh = wa -> height;
     c -> oldbw = wa -> border_width;
 
-    updatetitle(c);
-    if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+    if (!textreply(r[PropNetName], c -> name, sizeof c -> name)) {
+        textreply(r[PropName], c -> name, sizeof c -> name);
+    }
+
+    if (c -> name[0] == '\0') /* hack to mark broken clients */ {
+        strcpy(c -> name, broken);
+    }
+
+    trans = windowreply(r[PropTransient]);
+
+    if (trans != None && (t = wintoclient(trans))) {
         c -> mon = t -> mon;
         c -> tags = t -> tags;
     } else {
         c -> mon = selmon;
-        applyrules(c);
+        applyrules(c, r[PropClass]);
         term = termforwin(c);
     }
 
@@ -2221,15 +2873,26 @@ void manage(Window w, XWindowAttributes *wa) {
              (c -> x + (c -> w / 2) < c -> mon -> wx + c -> mon -> ww)) ? bh : c -> mon -> my);
 
     c -> bw = 2;
+    c -> curbw = wa -> border_width;
 
-    wc.border_width = c -> bw;
-
-    XConfigureWindow(dpy, w, CWBorderWidth, &wc);
     XSetWindowBorder(dpy, w, scheme[SchemeNorm][ColBorder].pixel);
-    configure(c); /* propagates border_width, if size doesn't change */
-    updatewindowtype(c);
-    updatesizehints(c);
-    updatewmhints(c);
+    setwindowtype(c, atomreply(r[PropState]), atomreply(r[PropType]));
+
+    if (!sizehintsreply(r[PropNormalHints], &size)) {
+        size.flags = PSize;
+    }
+
+    setsizehints(c, &size);
+
+    if (wmhintsreply(r[PropHints], &wmh)) {
+        setwmhints(c, &wmh);
+    }
+
+    c -> canping = atomsreplyhas(r[PropProtocols], netatom[NetWMPing]);
+
+    for (i = 0; i < PropLast; i++) {
+        free(r[i]);
+    }
 
     c -> x = c -> mon -> mx + (c -> mon -> mw - WIDTH(c)) / 2;
     c -> y = c -> mon -> my + (c -> mon -> mh - HEIGHT(c)) / 2;
@@ -2245,11 +2908,24 @@ void manage(Window w, XWindowAttributes *wa) {
         XRaiseWindow(dpy, c -> win);
     }
 
+    /* decided before the first map, so the window is only placed once */
+    if (term && swallow(term, c)) {
+        focus(NULL);
+        return;
+    }
+
     attachbottom(c);
     attachstack(c);
     XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &(c -> win), 1);
-    XMoveResizeWindow(dpy, c -> win, c -> x + 2 * sw, c -> y, c -> w, c -> h); /* some windows require this */
-    setclientstate(c, NormalState);
+
+    if (c -> iconify && !ISVISIBLE(c)) {
+        /* never mapped, so there is no unmap to wait for */
+        c -> isiconic = 1;
+        setclientstate(c, IconicState);
+        updatenetstate(c);
+    } else {
+        setclientstate(c, NormalState);
+    }
 
     if (c -> mon == selmon) {
         unfocus(selmon -> sel, 0);
@@ -2258,9 +2934,22 @@ void manage(Window w, XWindowAttributes *wa) {
     c -> mon -> sel = c;
     arrange(c -> mon);
 
-    XMapWindow(dpy, c -> win);
+    if (c -> isnew) {
+        /* not placed by the layout, i.e. on a hidden tag */
+        c -> isnew = 0;
+        c -> curbw = wc.border_width = c -> bw;
+        wc.x = ISVISIBLE(c) || c -> isiconic ? c -> x : WIDTH(c) * -2;
+        wc.y = c -> y;
+        wc.width = c -> w;
+        wc.height = c -> h;
 
-    if (term) { swallow(term, c); }
+        XConfigureWindow(dpy, w, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
+        configure(c);
+    }
+
+    if (!c -> isiconic) {
+        XMapWindow(dpy, c -> win);
+    }
 
     focus(NULL);
 }
@@ -2268,50 +2957,86 @@ void manage(Window w, XWindowAttributes *wa) {
 
 void mappingnotify(XEvent *e) {
     XMappingEvent *ev = &e -> xmapping;
+    unsigned int oldmask = numlockmask;
+    Client *c;
+    Monitor *m;
 
     XRefreshKeyboardMapping(ev);
 
-    if (ev -> request == MappingKeyboard) {
+    if (ev -> request == MappingPointer) { return; }
+
+    /* Num_Lock may have moved to another keycode or modifier */
+    numlockstale = 1;
+    updatenumlockmask();
+
+    if (ev -> request == MappingKeyboard || numlockmask != oldmask) {
         grabkeys();
     }
+
+    if (numlockmask == oldmask) { return; }
+
+    for (m = mons; m; m = m -> next) {
+        for (c = m -> clients; c; c = c -> next) {
+            c -> grabstate = GrabNone;
+            grabbuttons(c, c == selmon -> sel);
+        }
+    }
 }
 
 
 void maprequest(XEvent *e) {
-    static XWindowAttributes wa;
     XMapRequestEvent *ev = &e -> xmaprequest;
-
-    if (!XGetWindowAttributes(dpy, ev -> window, &wa)) { return; }
-
-    if (wa.override_redirect) { return; }
-
-    if (!wintoclient(ev -> window)) {
-        manage(ev -> window, &wa);
+    XWindowAttributes wa;
+    WinProps wp;
+    xcb_get_window_attributes_cookie_t ac;
+    xcb_get_geometry_cookie_t gc;
+    xcb_get_window_attributes_reply_t *a;
+    xcb_get_geometry_reply_t *g;
+
+    if (wintoclient(ev -> window)) { return; }
+
+    /* everything manage() needs goes out before the first reply is awaited */
+    ac = xcb_get_window_attributes(xcon, ev -> window);
+    gc = xcb_get_geometry(xcon, ev -> window);
+    requestprops(ev -> window, &wp);
+
+    a = xcb_get_window_attributes_reply(xcon, ac, NULL);
+    g = xcb_get_geometry_reply(xcon, gc, NULL);
+
+    if (a && g && !a -> override_redirect) {
+        wa.x = g -> x;
+        wa.y = g -> y;
+        wa.width = g -> width;
+        wa.height = g -> height;
+        wa.border_width = g -> border_width;
+
+        manage(ev -> window, &wa, &wp);
+    } else {
+        discardprops(&wp);
     }
+
+    free(a);
+    free(g);
 }
 
 
-void motionnotify(XEvent *e) {
-    static Monitor *mon = NULL;
-    Monitor *m;
-    XMotionEvent *ev = &e -> xmotion;
+void hideoutline() {
+    int i;
 
-    if (ev -> window != root) {
-        return;
+    for (i = 0; i < 4; i++) {
+        if (outlinewin[i]) { XUnmapWindow(dpy, outlinewin[i]); }
     }
+}
 
-    if ((m = recttomon(ev -> x_root, ev -> y_root, 1, 1)) != mon && mon) {
-        unfocus(selmon -> sel, 1);
-        selmon = m;
-        focus(NULL);
-    }
 
-    mon = m;
+/* heavy clients are dragged as an outline and resized once on release */
+int useoutline(const Client *c) {
+    return c -> outline || (outlinesize && (unsigned int)(c -> w * c -> h) > outlinesize);
 }
 
 
 void movemouse(const Arg *arg) {
-    int x, y, ocx, ocy, nx, ny;
+    int x, y, ocx, ocy, nx, ny, outline, moved = 0;
     Client *c;
     Monitor *m;
     XEvent ev;
@@ -2324,8 +3049,9 @@ void movemouse(const Arg *arg) {
     if (c -> isfullscreen) /* no support moving fullscreen windows by mouse */ { return; }
 
     restack(selmon);
-    ocx = c -> x;
-    ocy = c -> y;
+    ocx = nx = c -> x;
+    ocy = ny = c -> y;
+    outline = useoutline(c);
 
     if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
         None, cursor[CurMove] -> cursor, CurrentTime) != GrabSuccess) { return; }
@@ -2341,6 +3067,8 @@ void movemouse(const Arg *arg) {
                 handler[ev.type](&ev);
                 break;
             case MotionNotify:
+                setptr(ev.xmotion.x_root, ev.xmotion.y_root);
+
                 if ((ev.xmotion.time - lasttime) <= (1000 / 60)) { continue; }
                 
                 lasttime = ev.xmotion.time;
@@ -2366,7 +3094,12 @@ void movemouse(const Arg *arg) {
                 }
 
                 if (!selmon -> lt[selmon -> sellt] -> arrange || c -> isfloating) {
-                    resize(c, nx, ny, c -> w, c -> h, 1);
+                    if (outline) {
+                        drawoutline(nx, ny, WIDTH(c), HEIGHT(c));
+                        moved = 1;
+                    } else {
+                        resize(c, nx, ny, c -> w, c -> h, 1);
+                    }
                 }
 
                 break;
@@ -2374,6 +3107,12 @@ void movemouse(const Arg *arg) {
 
     } while (ev.type != ButtonRelease);
 
+    if (outline) {
+        hideoutline();
+
+        if (moved) { resize(c, nx, ny, c -> w, c -> h, 1); }
+    }
+
     XUngrabPointer(dpy, CurrentTime);
 
     if ((m = recttomon(c -> x, c -> y, c -> w, c -> h)) != selmon) {
@@ -2391,6 +3130,84 @@ Client *nexttiled(Client *c) {
 }
 
 
+/* milliseconds until the next timer is due, -1 if none is armed */
+int nexttimeout() {
+    long t = nowms(), next = -1;
+    int i;
+
+    for (i = 0; i < TimerLast; i++) {
+        if (timers[i].at && (next < 0 || timers[i].at - t < next)) {
+            next = MAX(timers[i].at - t, 0);
+        }
+    }
+
+    return (int)next;
+}
+
+
+long nowms() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+
+/* Ping the visible clients that speak _NET_WM_PING. A client still owing the
+ * answer to the previous ping is marked unresponsive. */
+void pingclients() {
+    long t = nowms();
+    Client *c;
+    Monitor *m;
+    XEvent ev;
+
+    for (m = mons; m; m = m -> next) {
+        for (c = m -> clients; c; c = c -> next) {
+            if (!c -> canping || !ISVISIBLE(c) || c -> isfrozen) {
+                c -> pingsent = 0; /* a late answer still counts, a missing one does not */
+                continue;
+            }
+
+            if (c -> pingsent) {
+                if (!c -> isunresponsive) {
+                    c -> isunresponsive = 1;
+                    drawtab(m);
+                }
+
+                continue;
+            }
+
+            ev.type = ClientMessage;
+            ev.xclient.window = c -> win;
+            ev.xclient.message_type = wmatom[WMProtocols];
+            ev.xclient.format = 32;
+            ev.xclient.data.l[0] = netatom[NetWMPing];
+            ev.xclient.data.l[1] = t & 0xffffffffL; /* echoed back, gives the latency */
+            ev.xclient.data.l[2] = c -> win;
+            ev.xclient.data.l[3] = ev.xclient.data.l[4] = 0;
+            XSendEvent(dpy, c -> win, False, NoEventMask, &ev);
+
+            c -> pingsent = t;
+        }
+    }
+
+    armtimer(TimerPing, t + pingtimeout * 1000L);
+}
+
+
+void pong(Client *c, long stamp) {
+    c -> pingms = (nowms() - stamp) & 0xffffffffL;
+    c -> pingsent = 0;
+
+    if (c -> isunresponsive) {
+        c -> isunresponsive = 0;
+        configure(c); /* the notifications skipped meanwhile */
+        drawtab(c -> mon);
+    }
+}
+
+
 void pop(Client *c) {
     detach(c);
     attach(c);
@@ -2399,9 +3216,53 @@ void pop(Client *c) {
 }
 
 
+/* Hand f to the render thread, replacing an older frame for the same window
+ * that it has not started on. Without the thread f is drawn right away. */
+void postframe(BarFrame *f) {
+    BarFrame **p;
+
+    if (!rdpy) {
+        renderframe(drw, scheme, &sprites, f);
+        publishframe(f);
+        free(f);
+        return;
+    }
+
+    pthread_mutex_lock(&barlock);
+
+    for (p = &frames; *p && (*p) -> win != f -> win; p = &(*p) -> next);
+
+    if (*p) {
+        f -> next = (*p) -> next;
+        free(*p);
+    }
+
+    *p = f;
+    pthread_cond_signal(&barcond);
+    pthread_mutex_unlock(&barlock);
+}
+
+
+/* give the widths measured while drawing f to its monitor, under barlock */
+void publishframe(BarFrame *f) {
+    nframes++;
+    nframeops += f -> ops;
+    nframereqs += f -> reqs;
+
+    if (f -> istab) {
+        f -> m -> ntabs = f -> ntabs;
+        memcpy(f -> m -> tab_widths, f -> tabw, sizeof f -> tabw);
+    } else {
+        f -> m -> ltw = f -> ltw;
+    }
+}
+
+
 void propertynotify(XEvent *e) {
     Client *c;
     Window trans;
+    int urgent, neverfocus;
+    xcb_get_property_reply_t *r;
     XPropertyEvent *ev = &e -> xproperty;
 
     if ((ev -> window == root) && (ev -> atom == XA_WM_NAME)) {
@@ -2412,25 +3273,43 @@ void propertynotify(XEvent *e) {
             switch(ev -> atom) {
                 default: break;
                 case XA_WM_TRANSIENT_FOR:
-                    if (!c -> isfloating && (XGetTransientForHint(dpy, c -> win, &trans)) &&
-                        (c -> isfloating = (wintoclient(trans)) != NULL)) { arrange(c -> mon); }
+                    if (c -> isfloating) { break; }
+
+                    r = propreply(getprop(c -> win, XA_WM_TRANSIENT_FOR, XA_WINDOW, 1));
+                    trans = windowreply(r);
+                    free(r);
+
+                    if ((c -> isfloating = trans && wintoclient(trans) != NULL)) { arrange(c -> mon); }
                     break;
                 case XA_WM_NORMAL_HINTS:
-                    updatesizehints(c);
+                    if (ISVISIBLE(c)) {
+                        updatesizehints(c);
+                    } else {
+                        c -> pending |= PendingSizeHints;
+                    }
                     break;
                 case XA_WM_HINTS:
+                    urgent = c -> isurgent;
+                    neverfocus = c -> neverfocus;
                     updatewmhints(c);
-                    drawbars();
-                    drawtabs();
+
+                    if (c -> isurgent != urgent || c -> neverfocus != neverfocus) { drawbar(c -> mon); }
                     break;
             }
 
                 if (ev -> atom == XA_WM_NAME || ev -> atom == netatom[NetWMName]) {
-                    updatetitle(c);
-                    drawtab(c -> mon);
+                    /* titles only show in the tabs of visible clients */
+                    if (ISVISIBLE(c)) {
+                        updatetitle(c);
+                        drawtab(c -> mon);
+                    } else {
+                        c -> pending |= PendingTitle;
+                    }
                 }
 
                 if (ev -> atom == netatom[NetWMWindowType]) { updatewindowtype(c); }
+
+                if (ev -> atom == wmatom[WMProtocols]) { c -> canping = hasprotocol(c, netatom[NetWMPing]); }
             }
 }
 
@@ -2488,7 +3367,9 @@ void organizetags(const Arg *arg) {
 
 
 void resize(Client *c, int x, int y, int w, int h, int interact) {
-    if (applysizehints(c, &x, &y, &w, &h, interact)) {
+    c -> isdeferred = 0;
+
+    if (applysizehints(c, &x, &y, &w, &h, interact) || c -> isnew) {
         resizeclient(c, x, y, w, h);
     }
 }
@@ -2511,17 +3392,48 @@ void resizeclient(Client *c, int x, int y, int w, int h) {
             wc.border_width = 0;
     }
 
+    c -> curbw = wc.border_width;
+    c -> isnew = 0;
+
     XConfigureWindow(dpy, c -> win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
     configure(c);
     XSync(dpy, False);
 }
 
 
+/* Resize c to w x h during a drag. With an alarm, the new size is announced
+ * by _NET_WM_SYNC_REQUEST and 1 is returned while its redraw is awaited. */
+int syncresize(Client *c, int w, int h, XSyncAlarm alarm, unsigned long *value) {
+    int x = c -> x, y = c -> y;
+    XSyncAlarmAttributes attr;
+
+    if (!applysizehints(c, &x, &y, &w, &h, 1)) { return 0; }
+
+    if (alarm) {
+        ++*value;
+        XSyncIntsToValue(&attr.trigger.wait_value, *value & 0xffffffffUL, (*value >> 32) & 0x7fffffffUL);
+        XSyncChangeAlarm(dpy, alarm, XSyncCAValue, &attr);
+        sendsyncrequest(c, *value);
+    }
+
+    resizeclient(c, x, y, w, h);
+
+    return alarm != None;
+}
+
+
 void resizemouse(const Arg *arg) {
-    int ocx, ocy, nw, nh;
+    int ocx, ocy, nw, nh, outline, moved = 0, waiting = 0, pending = 0, got;
+    unsigned long syncvalue = 0;
+    long sent = 0, left;
+    struct pollfd pfd = { .fd = ConnectionNumber(dpy), .events = POLLIN };
     Client *c;
     Monitor *m;
     XEvent ev;
+    XSyncCounter counter;
+    XSyncAlarm alarm = None;
+    XSyncAlarmAttributes attr;
+    XSyncValue v;
     Time lasttime = 0;
 
     if (!(c = selmon -> sel)) { return; }
@@ -2530,6 +3442,24 @@ void resizemouse(const Arg *arg) {
     restack(selmon);
     ocx = c -> x;
     ocy = c -> y;
+    nw = c -> w;
+    nh = c -> h;
+    outline = useoutline(c);
+
+    /* clients speaking _NET_WM_SYNC_REQUEST get a new size once they drew the last one */
+    if (!outline && (counter = getsynccounter(c)) && XSyncQueryCounter(dpy, counter, &v)) {
+        syncvalue = (unsigned long)XSyncValueHigh32(v) << 32 | XSyncValueLow32(v);
+
+        attr.trigger.counter = counter;
+        attr.trigger.value_type = XSyncAbsolute;
+        attr.trigger.test_type = XSyncPositiveComparison;
+        XSyncIntsToValue(&attr.trigger.wait_value, (syncvalue + 1) & 0xffffffffUL, ((syncvalue + 1) >> 32) & 0x7fffffffUL);
+        XSyncIntToValue(&attr.delta, 0);
+        attr.events = True;
+
+        alarm = XSyncCreateAlarm(dpy, XSyncCACounter|XSyncCAValueType|XSyncCAValue
+                                 |XSyncCATestType|XSyncCADelta|XSyncCAEvents, &attr);
+    }
 
     if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
         None, cursor[CurResize] -> cursor, CurrentTime) != GrabSuccess) { return; }
@@ -2537,7 +3467,25 @@ void resizemouse(const Arg *arg) {
     XWarpPointer(dpy, None, c -> win, 0, 0, 0, 0, c -> w + c -> bw - 1, c -> h + c -> bw - 1);
 
     do {
-        XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+        got = 0;
+
+        /* a client past syncwait gets the newest size even if the pointer stopped */
+        if (waiting && pending) {
+            while (!(got = XCheckIfEvent(dpy, &ev, isdragevent, NULL)) &&
+                   (left = sent + syncwait - nowms()) > 0) {
+                poll(&pfd, 1, left);
+            }
+
+            if (!got) {
+                waiting = syncresize(c, nw, nh, alarm, &syncvalue);
+                sent = nowms();
+                pending = 0;
+                continue;
+            }
+        }
+
+        if (!got) { XIfEvent(dpy, &ev, isdragevent, NULL); }
+
         switch(ev.type) {
             case ConfigureRequest:
             case Expose:
@@ -2545,7 +3493,10 @@ void resizemouse(const Arg *arg) {
                 handler[ev.type](&ev);
                 break;
             case MotionNotify:
-                if ((ev.xmotion.time - lasttime) <= (1000 / 60)) { continue; }
+                setptr(ev.xmotion.x_root, ev.xmotion.y_root);
+
+                /* without the protocol, pace by time */
+                if (!alarm && (ev.xmotion.time - lasttime) <= (1000 / 60)) { continue; }
                 lasttime = ev.xmotion.time;
 
                 nw = MAX(ev.xmotion.x - ocx - 2 * c -> bw + 1, 1);
@@ -2562,17 +3513,50 @@ void resizemouse(const Arg *arg) {
                 }
 
                 if (!selmon -> lt[selmon -> sellt] -> arrange || c -> isfloating) {
-                    resize(c, c -> x, c -> y, nw, nh, 1);
+                    if (outline) {
+                        drawoutline(c -> x, c -> y, nw + 2 * c -> bw, nh + 2 * c -> bw);
+                        moved = 1;
+                    } else if (waiting && nowms() - sent < syncwait) {
+                        pending = 1;
+                    } else {
+                        waiting = syncresize(c, nw, nh, alarm, &syncvalue);
+                        sent = nowms();
+                        pending = 0;
+                    }
+                }
+
+                break;
+            default:
+                /* the client drew the last size, send the newest one */
+                if (alarm && ev.type == syncevbase + XSyncAlarmNotify &&
+                    ((XSyncAlarmNotifyEvent *)&ev) -> alarm == alarm) {
+                    waiting = 0;
+
+                    if (pending) {
+                        waiting = syncresize(c, nw, nh, alarm, &syncvalue);
+                        sent = nowms();
+                        pending = 0;
+                    }
                 }
 
                 break;
         }
     } while (ev.type != ButtonRelease);
 
+    if (outline) {
+        hideoutline();
+
+        if (moved) { resize(c, c -> x, c -> y, nw, nh, 1); }
+    } else if (pending) {
+        resize(c, c -> x, c -> y, nw, nh, 1);
+    }
+
+    if (alarm) { XSyncDestroyAlarm(dpy, alarm); }
+
     XWarpPointer(dpy, None, c -> win, 0, 0, 0, 0, c -> w + c -> bw - 1, c -> h + c -> bw - 1);
+    setptr(c -> x + c -> w + 2 * c -> bw - 1, c -> y + c -> h + 2 * c -> bw - 1);
     XUngrabPointer(dpy, CurrentTime);
-
-    while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+    ignoreenters();
 
     if ((m = recttomon(c -> x, c -> y, c -> w, c -> h)) != selmon) {
         sendmon(c, m);
@@ -2585,12 +3569,18 @@ void resizemouse(const Arg *arg) {
 
 void restack(Monitor *m) {
     Client *c;
-    XEvent ev;
     XWindowChanges wc;
 
     drawbar(m);
     drawtab(m);
 
+    /* a covered client came to the front, move it to its slot first */
+    if (m -> sel && m -> sel -> isdeferred && m -> lt[m -> sellt] -> arrange) {
+        m -> lt[m -> sellt] -> arrange(m);
+    }
+
+    updatecovered(m);
+
     if (!m -> sel) { return; }
 
     if (m -> sel -> isfloating || !m -> lt[m -> sellt] -> arrange) {
@@ -2609,24 +3599,253 @@ void restack(Monitor *m) {
         }
     }
 
-    XSync(dpy, False);
-
-    while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
-
     if (m == selmon && (m -> tagset[m -> seltags] & m -> sel -> tags) 
                  && selmon -> lt[selmon -> sellt] != &layouts[2]) {
         warp(m -> sel);
     }
+
+    /* after the warp, so the crossings it causes are dropped too */
+    ignoreenters();
+}
+
+
+/* drw and scheme are those of the thread drawing, the globals without one */
+void renderbar(Drw *drw, Clr **scheme, Sprites *sp, BarFrame *f) {
+    int x, w, sw = 0, k;
+    unsigned int i;
+
+    /* draw status first so it can be overdrawn by tags later */
+    drw_setscheme(drw, scheme[SchemeNorm]);
+    sw = TEXTW(f -> stext) - lrpad + 2; /* 2px right padding */
+    drw_text(drw, f -> ww - sw, 0, sw, bh, 0, f -> stext, 0);
+
+    x = 0;
+
+    /* layout symbols with a count in them are not pre-rendered */
+    for (k = 0; layouts[k].symbol && strcmp(layouts[k].symbol, f -> ltsymbol); k++);
+
+    if (layouts[k].symbol) {
+        k += LENGTH(tags) * 4;
+        x = f -> ltw = sp -> w[k];
+        drw_copy(drw, sp -> pm, sp -> x[k], 0, x, bh, 0, 0);
+    } else {
+        w = f -> ltw = TEXTW(f -> ltsymbol);
+        drw_setscheme(drw, scheme[SchemeNorm]);
+        x = drw_text(drw, x, 0, w, bh, lrpad / 2, f -> ltsymbol, 0);
+    }
+
+    for (i = 0; i < LENGTH(tags); i++) {
+        /* do not draw vacant tags */
+        if (!(f -> occ & 1 << i || f -> tagset & 1 << i)) { continue; }
+
+        k = TAGSPRITE(i, f -> tagset & 1 << i, f -> urg & 1 << i);
+        w = tagw[i];
+        drw_copy(drw, sp -> pm, sp -> x[k], 0, w, bh, x, 0);
+
+        x += w;
+    }
+
+    if ((w = f -> ww - sw - x) > bh) {
+        drw_setscheme(drw, scheme[SchemeNorm]);
+        drw_rect(drw, x, 0, w, bh, 1, 1);
+    }
+}
+
+
+void renderframe(Drw *drw, Clr **scheme, Sprites *sp, BarFrame *f) {
+    /* the monitor may be wider than the screen was at startup */
+    if (drw -> w < f -> ww) { drw_resize(drw, f -> ww, bh); }
+
+    drw_setshm(drw, f -> shm);
+    drw_begin(drw);
+
+    if (f -> istab) {
+        rendertab(drw, scheme, f);
+    } else {
+        renderbar(drw, scheme, sp, f);
+    }
+
+    drw_end(drw, f -> win, 0, 0, f -> ww, f -> istab ? th : bh);
+    f -> ops = drw -> frameops;
+    f -> reqs = drw -> framereqs;
+}
+
+
+/* Draw frames until stoprender(). Slow text never holds up event handling,
+ * and a bar redrawn faster than it can be painted only paints its last state. */
+void *renderloop(void *arg) {
+    BarFrame *f;
+
+    pthread_mutex_lock(&barlock);
+
+    for (;;) {
+        while (rendering && !frames) {
+            pthread_cond_wait(&barcond, &barlock);
+        }
+
+        if (!rendering) { break; }
+
+        f = curframe = frames;
+        frames = f -> next;
+        pthread_mutex_unlock(&barlock);
+
+        renderframe(rdrw, rscheme, &rsprites, f);
+
+        pthread_mutex_lock(&barlock);
+        publishframe(f);
+        curframe = NULL;
+        pthread_cond_signal(&framecond);
+        free(f);
+    }
+
+    pthread_mutex_unlock(&barlock);
+
+    return NULL;
+}
+
+
+void rendertab(Drw *drw, Clr **scheme, BarFrame *f) {
+    int i;
+    int sorted_label_widths[25];
+    int tot_width = 0;
+    int maxsize = bh;
+    int x = 0, w = 0;
+
+    /* Calculates number of labels and their width */
+    for (i = 0; i < f -> ntabs; i++) {
+        f -> tabw[i] = TEXTW(f -> names[i]);
+        tot_width += f -> tabw[i];
+    }
+
+    if (tot_width > f -> ww) { //not enough space to display the labels, they need to be truncated
+      memcpy(sorted_label_widths, f -> tabw, sizeof(int) * f -> ntabs);
+      qsort(sorted_label_widths, f -> ntabs, sizeof(int), cmpint);
+
+      for (i = 0; i < f -> ntabs; ++i) {
+        if (tot_width + (f -> ntabs - i) * sorted_label_widths[i] > f -> ww) {
+            break;
+        }
+
+        tot_width += sorted_label_widths[i];
+      }
+      maxsize = (f -> ww - tot_width) / (f -> ntabs - i);
+    } else {
+      maxsize = f -> ww;
+    }
+
+    for (i = 0; i < f -> ntabs; i++) {
+      if (f -> tabw[i] >  maxsize) {
+          f -> tabw[i] = maxsize;
+      }
+
+      w = f -> tabw[i];
+
+      drw_setscheme(drw, scheme[f -> tabscheme[i]]);
+      drw_text(drw, x, 0, w, th, 0, f -> names[i], 0);
+
+      x += w;
+    }
+
+    drw_setscheme(drw, scheme[SchemeNorm]);
+
+    /* cleans interspace between window names and current viewed tag label */
+    w = f -> ww - x;
+    drw_text(drw, x, 0, w, th, 0, "", 0);
+
+    /* view info */
+    x += w;
+
+    drw_text(drw, x, 0, 0, th, 0, 0, 0);
 }
 
 
 void run() {
     XEvent ev;
+    struct pollfd pfd = { .fd = ConnectionNumber(dpy), .events = POLLIN };
 
     /* main event loop */
     XSync(dpy, False);
-    while (running && !XNextEvent(dpy, &ev)) {
-        if (handler[ev.type]) { handler[ev.type](&ev); /* call handler */ }
+    while (running) {
+        while (running && XPending(dpy)) {
+            XNextEvent(dpy, &ev);
+            nevents++;
+            if (ev.type < LASTEvent && handler[ev.type]) { handler[ev.type](&ev); /* call handler */ }
+        }
+
+        runtimers();
+
+        /* XPending() flushed the output buffer, sleep until input or a timer */
+        if (running && !XPending(dpy)) {
+            poll(&pfd, 1, nexttimeout());
+            nwakeups++;
+        }
+    }
+}
+
+
+void reportwakeups() {
+    Client *c;
+    Monitor *m;
+
+    fprintf(stderr, "dynamd: %.1f wakeups/s, %.1f events/s\n",
+            (double)nwakeups / wakeupstats, (double)nevents / wakeupstats);
+
+    pthread_mutex_lock(&barlock);
+
+    if (nframes) {
+        fprintf(stderr, "dynamd: %u bar frames, %.1f operations and %.1f requests per frame\n",
+                nframes, (double)nframeops / nframes, (double)nframereqs / nframes);
+    }
+
+    nframes = nframeops = nframereqs = 0;
+    pthread_mutex_unlock(&barlock);
+
+    /* name the clients flooding us with ConfigureRequests */
+    for (m = mons; m; m = m -> next) {
+        for (c = m -> clients; c; c = c -> next) {
+            if (c -> ncfg) {
+                fprintf(stderr, "dynamd: %s: %.1f configure requests/s, %.1f applied/s\n",
+                        c -> name, (double)c -> ncfg / wakeupstats, (double)c -> ncfgapplied / wakeupstats);
+            }
+
+            if (c -> canping && (c -> pingms || c -> isunresponsive)) {
+                fprintf(stderr, "dynamd: %s: ping %ld ms%s\n", c -> name, c -> pingms,
+                        c -> isunresponsive ? ", not responding" : "");
+            }
+
+            c -> ncfg = c -> ncfgapplied = 0;
+        }
+    }
+
+    nwakeups = nevents = 0;
+    armtimer(TimerStats, nowms() + wakeupstats * 1000L);
+}
+
+
+void runtimers() {
+    long t = nowms();
+    int i;
+
+    for (i = 0; i < TimerLast; i++) {
+        if (timers[i].at && timers[i].at <= t) {
+            timers[i].at = 0;
+            timers[i].func();
+        }
+    }
+}
+
+
+/* move the focused client's processes to the foreground class and all others
+ * to the background one, touching only processes whose class changed */
+void schedclients() {
+    pid_t fg = selmon -> sel ? selmon -> sel -> pid : 0;
+    Client *c;
+    Monitor *m;
+
+    for (m = mons; m; m = m -> next) {
+        for (c = m -> clients; c; c = c -> next) {
+            if (c -> pid) { setsched(c, c -> pid == fg ? SchedFg : SchedBg); }
+        }
     }
 }
 
@@ -2635,23 +3854,26 @@ void scan() {
     unsigned int i, num;
     Window d1, d2, *wins = NULL;
     XWindowAttributes wa;
+    WinProps wp;
 
     if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
         for (i = 0; i < num; i++) {
-            if (!XGetWindowAttributes(dpy, wins[i], &wa) || 
+            if (ismonwin(wins[i]) || !XGetWindowAttributes(dpy, wins[i], &wa) || 
                 wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1)) { continue; }
 
             if (wa.map_state == IsViewable || getstate(wins[i]) == IconicState) {  
-                manage(wins[i], &wa); 
+                requestprops(wins[i], &wp);
+                manage(wins[i], &wa, &wp); 
             }
         }
 
         for (i = 0; i < num; i++) { /* now the transients */
-            if (!XGetWindowAttributes(dpy, wins[i], &wa)) { continue; }
+            if (ismonwin(wins[i]) || !XGetWindowAttributes(dpy, wins[i], &wa)) { continue; }
 
             if (XGetTransientForHint(dpy, wins[i], &d1) && 
                (wa.map_state == IsViewable || getstate(wins[i]) == IconicState)) {  
-                manage(wins[i], &wa); 
+                requestprops(wins[i], &wp);
+                manage(wins[i], &wa, &wp); 
             }
         }
 
@@ -2678,6 +3900,10 @@ void sendmon(Client *c, Monitor *m) {
     attachstack(c);
     focus(NULL);
     arrange(NULL);
+
+    /* focus() only repainted the source monitor */
+    drawbar(m);
+    drawtab(m);
 }
 
 
@@ -2689,19 +3915,20 @@ void setclientstate(Client *c, long state) {
 }
 
 
+int hasprotocol(Client *c, Atom proto) {
+    xcb_get_property_reply_t *r = propreply(getprop(c -> win, wmatom[WMProtocols], XA_ATOM, 32));
+    int exists = atomsreplyhas(r, proto);
+
+    free(r);
+
+    return exists;
+}
+
+
 int sendevent(Client *c, Atom proto) {
-    int n;
-    Atom *protocols;
-    int exists = 0;
+    int exists = hasprotocol(c, proto);
     XEvent ev;
 
-    if (XGetWMProtocols(dpy, c -> win, &protocols, &n)) {
-        while (!exists && n--) {
-            exists = protocols[n] == proto;
-        }
-
-        XFree(protocols);
-    }
     if (exists) {
         ev.type = ClientMessage;
         ev.xclient.window = c -> win;
@@ -2716,6 +3943,23 @@ int sendevent(Client *c, Atom proto) {
 }
 
 
+/* ask c to set its sync counter to value once it has drawn the next configure */
+void sendsyncrequest(Client *c, unsigned long value) {
+    XEvent ev;
+
+    ev.type = ClientMessage;
+    ev.xclient.window = c -> win;
+    ev.xclient.message_type = wmatom[WMProtocols];
+    ev.xclient.format = 32;
+    ev.xclient.data.l[0] = netatom[NetWMSyncRequest];
+    ev.xclient.data.l[1] = CurrentTime;
+    ev.xclient.data.l[2] = value & 0xffffffffUL;
+    ev.xclient.data.l[3] = (value >> 32) & 0xffffffffUL;
+    ev.xclient.data.l[4] = 0;
+    XSendEvent(dpy, c -> win, False, NoEventMask, &ev);
+}
+
+
 void shiftview(const Arg *arg) {
     Arg shifted;
 
@@ -2738,17 +3982,92 @@ void setfocus(Client *c) {
                         XA_WINDOW, 32, PropModeReplace,
                         (unsigned char *) &(c -> win), 1);
     }
-
-    sendevent(c, wmatom[WMTakeFocus]);
+
+    if (!c -> isunresponsive) { sendevent(c, wmatom[WMTakeFocus]); }
+}
+
+
+/* Stop or resume the process behind c and every client sharing it. The
+ * cgroup freezer is preferred, SIGSTOP is the fallback. */
+void setfrozen(Client *c, int frozen) {
+    int how = FreezeNone;
+    Client *t;
+    Monitor *m;
+
+    if (!c -> isfrozen == !frozen) { return; }
+
+    if (frozen) {
+        if (writecgroup(c -> pid, "cgroup.freeze", "1", 1)) {
+            how = FreezeCgroup;
+        } else if (!kill(c -> pid, SIGSTOP)) {
+            how = FreezeSignal;
+        }
+    } else if (!thaw(c -> pid, c -> isfrozen)) {
+        /* still stopped, freezeclients() tries again */
+        how = c -> isfrozen;
+        armtimer(TimerFreeze, nowms() + 1000);
+    }
+
+    for (m = mons; m; m = m -> next) {
+        for (t = m -> clients; t; t = t -> next) {
+            if (t -> pid == c -> pid) { t -> isfrozen = how; }
+        }
+    }
+}
+
+
+/* Undo a Freeze* of pid. Fails while the process is still stopped, a
+ * process that is gone counts as thawed. */
+int thaw(pid_t pid, int how) {
+    if (how == FreezeCgroup ? writecgroup(pid, "cgroup.freeze", "0", 0) : !kill(pid, SIGCONT)) {
+        return 1;
+    }
+
+    return kill(pid, 0) < 0 && errno == ESRCH;
+}
+
+
+void setptr(int x, int y) {
+    ptrx = x;
+    ptry = y;
+    ptrknown = 1;
+}
+
+
+/* Apply a scheduling class to the process behind c and every client sharing
+ * it, through the cgroup cpu.weight when the cgroup is the client's own and
+ * the nice value of its process group otherwise. */
+void setsched(Client *c, int sched) {
+    char buf[16];
+    Client *t;
+    Monitor *m;
+    int w = sched == SchedFg ? fgweight : sched == SchedBg ? bgweight : 100;
+    int n = sched == SchedBg ? bgnice : 0;
+
+    if (c -> sched == sched) { return; }
+
+    snprintf(buf, sizeof buf, "%d", w);
+
+    /* a nice value that could not be lowered again would stick for good,
+     * and a class that was not applied is tried again next time */
+    if (!writecgroup(c -> pid, "cpu.weight", buf, 1) &&
+        (!canrenice || setpriority(getpgid(c -> pid) == c -> pid ? PRIO_PGRP : PRIO_PROCESS, c -> pid, n) < 0)) {
+        return;
+    }
+
+    for (m = mons; m; m = m -> next) {
+        for (t = m -> clients; t; t = t -> next) {
+            if (t -> pid == c -> pid) { t -> sched = sched; }
+        }
+    }
 }
 
 
 void setfullscreen(Client *c, int fullscreen) {
     if (fullscreen && !c -> isfullscreen) {
-        XChangeProperty(dpy, c -> win, netatom[NetWMState], XA_ATOM, 32,
-                        PropModeReplace, (unsigned char*)&netatom[NetWMFullscreen], 1);
-
         c -> isfullscreen = 1;
+        updatenetstate(c);
+
         c -> oldstate = c -> isfloating;
         c -> oldbw = c -> bw;
         c -> bw = 0;
@@ -2758,10 +4077,9 @@ void setfullscreen(Client *c, int fullscreen) {
         XRaiseWindow(dpy, c -> win);
 
     } else if (!fullscreen && c -> isfullscreen) {
-        XChangeProperty(dpy, c -> win, netatom[NetWMState], XA_ATOM, 32,
-                        PropModeReplace, (unsigned char*)0, 0);
-
         c -> isfullscreen = 0;
+        updatenetstate(c);
+
         c -> isfloating = c -> oldstate;
         c -> bw = c -> oldbw;
         c -> x = c -> oldx;
@@ -2775,6 +4093,25 @@ void setfullscreen(Client *c, int fullscreen) {
 }
 
 
+void seticonic(Client *c, int iconic) {
+    if (c -> isiconic == iconic) { return; }
+
+    c -> isiconic = iconic;
+
+    if (iconic) {
+        /* reported once on the window and once on root */
+        c -> ignoreunmap += 2;
+        XUnmapWindow(dpy, c -> win);
+        setclientstate(c, IconicState);
+    } else {
+        XMapWindow(dpy, c -> win);
+        setclientstate(c, NormalState);
+    }
+
+    updatenetstate(c);
+}
+
+
 void setlayout(const Arg *arg) {
     if (!arg || !arg -> v || arg -> v != selmon -> lt[selmon -> sellt]) {
         selmon -> sellt = selmon -> pertag -> sellts[selmon -> pertag -> curtag] ^= 1;
@@ -2811,8 +4148,8 @@ void setmfact(const Arg *arg) {
 
 void setup() {
     int i;
+    struct rlimit rl;
     XSetWindowAttributes wa;
-    Atom utf8string;
 
     /* clean up any zombies immediately */
     sigchld(0);
@@ -2844,9 +4181,16 @@ void setup() {
     netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
     netatom[NetWMCheck] = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
     netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+    netatom[NetWMHidden] = XInternAtom(dpy, "_NET_WM_STATE_HIDDEN", False);
     netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
     netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
     netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+    netatom[NetWMSyncRequest] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+    netatom[NetWMSyncRequestCounter] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
+    netatom[NetWMPing] = XInternAtom(dpy, "_NET_WM_PING", False);
+
+    /* _NET_WM_SYNC_REQUEST needs the SYNC extension */
+    syncext = XSyncQueryExtension(dpy, &syncevbase, &i) && XSyncInitialize(dpy, &i, &i);
 
     /* init cursors */
     cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
@@ -2860,6 +4204,15 @@ void setup() {
         scheme[i] = drw_scm_create(drw, colors[i], 3);
     }
 
+    /* from here on only the render thread uses Xft */
+    for (i = 0; i < LENGTH(tags); i++) {
+        tagw[i] = TEXTW(tags[i]);
+    }
+
+    buildsprites(drw, scheme, &sprites);
+    barshm = shmbars;
+    startrender();
+
     /* init bars */
     updatebars();
     updatestatus();
@@ -2881,12 +4234,18 @@ void setup() {
     /* select events */
     wa.cursor = cursor[CurNormal] -> cursor;
     wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask
-        |ButtonPressMask|PointerMotionMask|EnterWindowMask
+        |ButtonPressMask|EnterWindowMask
         |LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
     XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
     XSelectInput(dpy, root, wa.event_mask);
     grabkeys();
     focus(NULL);
+
+    if (wakeupstats) { armtimer(TimerStats, nowms() + wakeupstats * 1000L); }
+
+    /* taking a nice value back to 0 needs root or an RLIMIT_NICE of 20 */
+    canrenice = !geteuid() || (!getrlimit(RLIMIT_NICE, &rl) && (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= 20));
+    if (pingtimeout) { armtimer(TimerPing, nowms() + pingtimeout * 1000L); }
 }
 
 
@@ -2907,7 +4266,15 @@ void showhide(Client *c) {
 
     if (ISVISIBLE(c)) {
         /* show clients top down */
-        XMoveWindow(dpy, c -> win, c -> x, c -> y);
+        c -> hiddenat = 0;
+
+        if (c -> isfrozen) { setfrozen(c, 0); }
+
+        if (c -> pending) { updatepending(c); }
+
+        /* new windows are placed by resize() in a single configure */
+        if (!c -> isnew) { XMoveWindow(dpy, c -> win, c -> x, c -> y); }
+
         if ((!c -> mon -> lt[c -> mon -> sellt] -> arrange || c -> isfloating) && 
              !c -> isfullscreen) {
             resize(c, c -> x, c -> y, c -> w, c -> h, 0);
@@ -2916,7 +4283,32 @@ void showhide(Client *c) {
     } else {
         /* hide clients bottom up */
         showhide(c -> snext);
-        XMoveWindow(dpy, c -> win, WIDTH(c) * -2, c -> y);
+
+        if (c -> freeze && !c -> hiddenat) {
+            c -> hiddenat = nowms();
+            armtimer(TimerFreeze, c -> hiddenat + freezedelay * 1000L);
+        }
+
+        if (c -> iconify) {
+            seticonic(c, 1);
+        } else if (!c -> isnew) {
+            XMoveWindow(dpy, c -> win, WIDTH(c) * -2, c -> y);
+        }
+    }
+}
+
+
+/* map the visible clients that are still unmapped, once they are laid out */
+void showiconic(Monitor *m) {
+    Client *c;
+
+    for (c = m -> stack; c; c = c -> snext) {
+        if (!c -> isiconic || !ISVISIBLE(c)) { continue; }
+
+        seticonic(c, 0);
+
+        /* focus() ran before the window was viewable */
+        if (c == selmon -> sel) { setfocus(c); }
     }
 }
 
@@ -2961,6 +4353,74 @@ void spawn(const Arg *arg) {
 }
 
 
+/* Open the render thread's own connection with its own fonts and colors.
+ * Bars are drawn on the event thread if any of it fails. */
+void startrender() {
+    int i;
+
+    if (!(rdpy = XOpenDisplay(NULL))) { return; }
+
+    rdrw = drw_create(rdpy, screen, root, sw, bh);
+
+    if (!drw_fontset_create(rdrw, fonts, LENGTH(fonts))) { goto fail; }
+
+    rscheme = ecalloc(LENGTH(colors), sizeof(Clr *));
+
+    for (i = 0; i < LENGTH(colors); i++) {
+        rscheme[i] = drw_scm_create(rdrw, colors[i], 3);
+    }
+
+    buildsprites(rdrw, rscheme, &rsprites);
+    rendering = 1;
+
+    if (!pthread_create(&renderthread, NULL, renderloop, NULL)) { return; }
+
+    rendering = 0;
+    freesprites(rdrw, &rsprites);
+
+    for (i = 0; i < LENGTH(colors); i++) {
+        free(rscheme[i]);
+    }
+
+    free(rscheme);
+
+fail:
+    drw_free(rdrw);
+    XCloseDisplay(rdpy);
+    rdpy = NULL;
+}
+
+
+void stoprender() {
+    BarFrame *f;
+    int i;
+
+    if (!rdpy) { return; }
+
+    pthread_mutex_lock(&barlock);
+    rendering = 0;
+    pthread_cond_signal(&barcond);
+    pthread_mutex_unlock(&barlock);
+    pthread_join(renderthread, NULL);
+
+    while ((f = frames)) {
+        frames = f -> next;
+        free(f);
+    }
+
+    freesprites(rdrw, &rsprites);
+
+    for (i = 0; i < LENGTH(colors); i++) {
+        free(rscheme[i]);
+    }
+
+    free(rscheme);
+    drw_free(rdrw);
+    XCloseDisplay(rdpy);
+    rdpy = NULL;
+}
+
+
 void tag(const Arg *arg) {
     if (selmon -> sel && arg -> ui & TAGMASK) {
         selmon -> sel -> tags = arg -> ui & TAGMASK;
@@ -2987,6 +4447,14 @@ void togglebar(const Arg *arg) {
 }
 
 
+/* switch the bars between Xft and client-side rendering, to compare them */
+void togglebarshm(const Arg *arg) {
+    barshm = !barshm;
+    drawbars();
+    drawtabs();
+}
+
+
 void togglefloating(const Arg *arg) {
     if (!selmon -> sel) { return; }
     if (selmon -> sel -> isfullscreen) /* no support for fullscreen windows */ { return; }
@@ -3076,6 +4544,7 @@ void unfocus(Client *c, int setfocus) {
 void unmanage(Client *c, int destroyed) {
     Monitor *m = c -> mon;
     XWindowChanges wc;
+    int i;
 
     if (c -> swallowing) {
         unswallow(c);
@@ -3093,6 +4562,23 @@ void unmanage(Client *c, int destroyed) {
         return;
     }
 
+    if (c -> isfrozen) { setfrozen(c, 0); }
+
+    /* keep retrying for a process no other client is left to thaw */
+    if (c -> isfrozen && !pidsibling(c)) {
+        for (i = 0; i < LENGTH(unthawed) && unthawed[i].pid; i++);
+
+        if (i < LENGTH(unthawed)) {
+            unthawed[i].pid = c -> pid;
+            unthawed[i].how = c -> isfrozen;
+        } else {
+            kill(c -> pid, SIGCONT);
+        }
+    }
+
+    /* the class is process-wide, the remaining siblings keep it */
+    if (c -> sched && !pidsibling(c)) { setsched(c, SchedNone); }
+
     detach(c);
     detachstack(c);
 
@@ -3123,9 +4609,12 @@ void unmapnotify(XEvent *e) {
     XUnmapEvent *ev = &e -> xunmap;
 
     if ((c = wintoclient(ev -> window))) {
-        if (ev -> send_event) {
+        if (!ev -> send_event && c -> ignoreunmap) {
+            c -> ignoreunmap--; /* caused by seticonic() */
+        } else if (ev -> send_event && !c -> isiconic) {
             setclientstate(c, WithdrawnState);
         } else {
+            /* an iconic client only withdraws with a synthetic unmap */
             unmanage(c, 0);
         }
     }
@@ -3140,11 +4629,24 @@ void updatebars() {
         .event_mask = ButtonPressMask|ExposureMask
     };
 
+    XSetWindowAttributes iwa = {
+        .override_redirect = True,
+        .event_mask = EnterWindowMask
+    };
+
     XClassHint ch = {"dynamd", "dynamd"};
 
     for (m = mons; m; m = m -> next) {
         if (m -> barwin) { continue; }
 
+        /* crossing events on this replace a motion stream on root for
+         * noticing the pointer move to another monitor */
+        m -> inputwin = XCreateWindow(dpy, root, m -> mx, m -> my, m -> mw, m -> mh, 0, 0,
+                InputOnly, CopyFromParent, CWOverrideRedirect|CWEventMask, &iwa);
+
+        XMapWindow(dpy, m -> inputwin);
+        XLowerWindow(dpy, m -> inputwin);
+
         m -> barwin = XCreateWindow(dpy, root, m -> wx, m -> by, m -> ww, bh, 0, DefaultDepth(dpy, screen),
                 CopyFromParent, DefaultVisual(dpy, screen),
                 CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
@@ -3267,7 +4769,7 @@ int updategeom() {
 
                 while ((c = m -> clients)) {
                     dirty = 1;
-                    m -> clients = c -> next;
+                    detach(c);
                     detachstack(c);
                     c -> mon = mons;
                     attachbottom(c);
@@ -3307,6 +4809,9 @@ void updatenumlockmask() {
     unsigned int i, j;
     XModifierKeymap *modmap;
 
+    if (!numlockstale) { return; }
+
+    numlockstale = 0;
     numlockmask = 0;
     modmap = XGetModifierMapping(dpy);
 
@@ -3323,52 +4828,70 @@ void updatenumlockmask() {
 }
 
 
+/* fetch what changed while c was hidden, before it is laid out and drawn */
+void updatepending(Client *c) {
+    if (c -> pending & PendingTitle) { updatetitle(c); }
+
+    if (c -> pending & PendingSizeHints) { updatesizehints(c); }
+
+    c -> pending = 0;
+}
+
+
 void updatesizehints(Client *c) {
-    long msize;
+    xcb_get_property_reply_t *r;
     XSizeHints size;
 
-    if (!XGetWMNormalHints(dpy, c -> win, &size, &msize)) {
+    r = propreply(getprop(c -> win, XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, 18));
+
+    if (!sizehintsreply(r, &size)) {
         /* size is uninitialized, ensure that size.flags aren't used */
         size.flags = PSize;
     }
 
-    if (size.flags & PBaseSize) {
-        c -> basew = size.base_width;
-        c -> baseh = size.base_height;
-    } else if (size.flags & PMinSize) {
-        c -> basew = size.min_width;
-        c -> baseh = size.min_height;
+    free(r);
+    setsizehints(c, &size);
+}
+
+
+void setsizehints(Client *c, XSizeHints *size) {
+    if (size -> flags & PBaseSize) {
+        c -> basew = size -> base_width;
+        c -> baseh = size -> base_height;
+    } else if (size -> flags & PMinSize) {
+        c -> basew = size -> min_width;
+        c -> baseh = size -> min_height;
     } else {
         c -> basew = c -> baseh = 0;
     }
 
-    if (size.flags & PResizeInc) {
-        c -> incw = size.width_inc;
-        c -> inch = size.height_inc;
+    if (size -> flags & PResizeInc) {
+        c -> incw = size -> width_inc;
+        c -> inch = size -> height_inc;
     } else {
         c -> incw = c -> inch = 0;
     }
 
-    if (size.flags & PMaxSize) {
-        c -> maxw = size.max_width;
-        c -> maxh = size.max_height;
+    if (size -> flags & PMaxSize) {
+        c -> maxw = size -> max_width;
+        c -> maxh = size -> max_height;
     } else {
         c -> maxw = c -> maxh = 0;
     }
 
-    if (size.flags & PMinSize) {
-        c -> minw = size.min_width;
-        c -> minh = size.min_height;
-    } else if (size.flags & PBaseSize) {
-        c -> minw = size.base_width;
-        c -> minh = size.base_height;
+    if (size -> flags & PMinSize) {
+        c -> minw = size -> min_width;
+        c -> minh = size -> min_height;
+    } else if (size -> flags & PBaseSize) {
+        c -> minw = size -> base_width;
+        c -> minh = size -> base_height;
     } else {
         c -> minw = c -> minh = 0;
     }
 
-    if (size.flags & PAspect) {
-        c -> mina = (float)size.min_aspect.y / size.min_aspect.x;
-        c -> maxa = (float)size.max_aspect.x / size.max_aspect.y;
+    if (size -> flags & PAspect) {
+        c -> mina = (float)size -> min_aspect.y / size -> min_aspect.x;
+        c -> maxa = (float)size -> max_aspect.x / size -> max_aspect.y;
     } else {
         c -> maxa = c -> mina = 0.0;
     }
@@ -3377,6 +4900,47 @@ void updatesizehints(Client *c) {
 }
 
 
+/* Advertise the tiled clients that the front client of monocle or deck
+ * covers entirely. Only clients whose state changed are updated. */
+void updatecovered(Monitor *m) {
+    unsigned int i, skip = 0;
+    int covered;
+    Client *c, *f = NULL;
+
+    if (m -> lt[m -> sellt] -> arrange == monocle) {
+        f = toptiled(m, 0);
+    } else if (m -> lt[m -> sellt] -> arrange == deck) {
+        skip = m -> nmaster;
+        f = toptiled(m, skip);
+    }
+
+    for (i = 0, c = m -> clients; c; c = c -> next) {
+        covered = 0;
+
+        if (f && !c -> isfloating && ISVISIBLE(c)) {
+            covered = i++ >= skip && c != f;
+        }
+
+        if (covered != c -> iscovered) {
+            c -> iscovered = covered;
+            updatenetstate(c);
+        }
+    }
+}
+
+
+void updatenetstate(Client *c) {
+    Atom state[2];
+    int n = 0;
+
+    if (c -> isfullscreen) { state[n++] = netatom[NetWMFullscreen]; }
+    if (c -> isiconic || c -> iscovered) { state[n++] = netatom[NetWMHidden]; }
+
+    XChangeProperty(dpy, c -> win, netatom[NetWMState], XA_ATOM, 32,
+                    PropModeReplace, (unsigned char *)state, n);
+}
+
+
 void updatestatus() {
     Monitor* m;
 
@@ -3391,10 +4955,23 @@ void updatestatus() {
 
 
 void updatetitle(Client *c) {
-    if (!gettextprop(c -> win, netatom[NetWMName], c -> name, sizeof c -> name)) {
-        gettextprop(c -> win, XA_WM_NAME, c -> name, sizeof c -> name);
+    /* ask for both names at once, the fallback costs no extra round trip */
+    xcb_get_property_cookie_t net = getprop(c -> win, netatom[NetWMName], AnyPropertyType, UINT32_MAX / 4);
+    xcb_get_property_cookie_t wm = getprop(c -> win, XA_WM_NAME, AnyPropertyType, UINT32_MAX / 4);
+    xcb_get_property_reply_t *r;
+
+    r = propreply(net);
+
+    if (textreply(r, c -> name, sizeof c -> name)) {
+        xcb_discard_reply(xcon, wm.sequence);
+    } else {
+        free(r);
+        r = propreply(wm);
+        textreply(r, c -> name, sizeof c -> name);
     }
 
+    free(r);
+
     if (c -> name[0] == '\0') /* hack to mark broken clients */ {
         strcpy(c -> name, broken);
     }
@@ -3402,9 +4979,17 @@ void updatetitle(Client *c) {
 
 
 void updatewindowtype(Client *c) {
-    Atom state = getatomprop(c, netatom[NetWMState]);
-    Atom wtype = getatomprop(c, netatom[NetWMWindowType]);
+    xcb_get_property_cookie_t state = getprop(c -> win, netatom[NetWMState], XA_ATOM, 1);
+    xcb_get_property_cookie_t wtype = getprop(c -> win, netatom[NetWMWindowType], XA_ATOM, 1);
+    xcb_get_property_reply_t *rs = propreply(state), *rt = propreply(wtype);
+
+    setwindowtype(c, atomreply(rs), atomreply(rt));
+    free(rs);
+    free(rt);
+}
 
+
+void setwindowtype(Client *c, Atom state, Atom wtype) {
     if (state == netatom[NetWMFullscreen]) {
         setfullscreen(c, 1);
     }
@@ -3416,23 +5001,27 @@ void updatewindowtype(Client *c) {
 
 
 void updatewmhints(Client *c) {
-    XWMHints *wmh;
+    xcb_get_property_reply_t *r = propreply(getprop(c -> win, XA_WM_HINTS, XA_WM_HINTS, 9));
+    XWMHints wmh;
 
-    if ((wmh = XGetWMHints(dpy, c -> win))) {
-        if (c == selmon -> sel && wmh -> flags & XUrgencyHint) {
-            wmh -> flags &= ~XUrgencyHint;
-            XSetWMHints(dpy, c -> win, wmh);
-        } else {
-            c -> isurgent = (wmh -> flags & XUrgencyHint) ? 1 : 0;
-        }
+    if (wmhintsreply(r, &wmh)) { setwmhints(c, &wmh); }
 
-        if (wmh -> flags & InputHint) {
-            c -> neverfocus = !wmh -> input;
-        } else {
-            c -> neverfocus = 0;
-        }
+    free(r);
+}
 
-        XFree(wmh);
+
+void setwmhints(Client *c, XWMHints *wmh) {
+    if (c == selmon -> sel && wmh -> flags & XUrgencyHint) {
+        wmh -> flags &= ~XUrgencyHint;
+        XSetWMHints(dpy, c -> win, wmh);
+    } else {
+        c -> isurgent = (wmh -> flags & XUrgencyHint) ? 1 : 0;
+    }
+
+    if (wmh -> flags & InputHint) {
+        c -> neverfocus = !wmh -> input;
+    } else {
+        c -> neverfocus = 0;
     }
 }
 
@@ -3483,10 +5072,11 @@ void warp(const Client *c) {
 
     if (!c) {
         XWarpPointer(dpy, None, root, 0, 0, 0, 0, selmon -> wx + selmon -> ww / 2, selmon -> wy + selmon -> wh / 2);
+        setptr(selmon -> wx + selmon -> ww / 2, selmon -> wy + selmon -> wh / 2);
         return;
     }
 
-    if (!getrootptr(&x, &y) ||
+    if (!getptr(&x, &y) ||
         (x > c -> x - c -> bw &&
          y > c -> y - c -> bw &&
          x < c -> x + c -> w + c -> bw * 2 &&
@@ -3495,20 +5085,20 @@ void warp(const Client *c) {
         (c -> mon -> topbar && !y)) { return; }
 
     XWarpPointer(dpy, None, c -> win, 0, 0, 0, 0, c -> w / 2, c -> h / 2);
+    setptr(c -> x + c -> bw + c -> w / 2, c -> y + c -> bw + c -> h / 2);
 }
 
 
-pid_t winpid(Window w) {
+pid_t pidreply(xcb_res_query_client_ids_cookie_t ck) {
 
     pid_t result = 0;
 
-    xcb_res_client_id_spec_t spec = {0};
-    spec.client = w;
-    spec.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
+    xcb_res_client_id_spec_t spec;
 
     xcb_generic_error_t *e = NULL;
-    xcb_res_query_client_ids_cookie_t c = xcb_res_query_client_ids(xcon, 1, &spec);
-    xcb_res_query_client_ids_reply_t *r = xcb_res_query_client_ids_reply(xcon, c, &e);
+    xcb_res_query_client_ids_reply_t *r = xcb_res_query_client_ids_reply(xcon, ck, &e);
+
+    free(e);
 
     if (!r) { return (pid_t)0; }
 
@@ -3533,6 +5123,171 @@ pid_t winpid(Window w) {
 }
 
 
+/* Send every request manage() needs for w without waiting for the replies,
+ * so a new window costs one round trip instead of one per property. */
+void requestprops(Window w, WinProps *wp) {
+    const struct { Atom atom, type; uint32_t len; } p[PropLast] = {
+        [PropNetName]     = { netatom[NetWMName],        AnyPropertyType,   UINT32_MAX / 4 },
+        [PropName]        = { XA_WM_NAME,                AnyPropertyType,   UINT32_MAX / 4 },
+        [PropClass]       = { XA_WM_CLASS,               XA_STRING,         UINT32_MAX / 4 },
+        [PropTransient]   = { XA_WM_TRANSIENT_FOR,       XA_WINDOW,         1 },
+        [PropState]       = { netatom[NetWMState],       XA_ATOM,           1 },
+        [PropType]        = { netatom[NetWMWindowType],  XA_ATOM,           1 },
+        [PropNormalHints] = { XA_WM_NORMAL_HINTS,        XA_WM_SIZE_HINTS,  18 },
+        [PropHints]       = { XA_WM_HINTS,               XA_WM_HINTS,       9 },
+        [PropProtocols]   = { wmatom[WMProtocols],       XA_ATOM,           32 },
+    };
+    xcb_res_client_id_spec_t spec = { w, XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID };
+    int i;
+
+    for (i = 0; i < PropLast; i++) {
+        wp -> prop[i] = xcb_get_property(xcon, 0, w, p[i].atom, p[i].type, 0, p[i].len);
+    }
+
+    wp -> pid = xcb_res_query_client_ids(xcon, 1, &spec);
+}
+
+
+/* drop the replies of a window that is not going to be managed */
+void discardprops(const WinProps *wp) {
+    int i;
+
+    for (i = 0; i < PropLast; i++) {
+        xcb_discard_reply(xcon, wp -> prop[i].sequence);
+    }
+
+    xcb_discard_reply(xcon, wp -> pid.sequence);
+}
+
+
+xcb_get_property_cookie_t getprop(Window w, Atom atom, Atom type, uint32_t len) {
+    return xcb_get_property(xcon, 0, w, atom, type, 0, len);
+}
+
+
+/* the reply to a property request, NULL if the property is unset or the window is gone */
+xcb_get_property_reply_t *propreply(xcb_get_property_cookie_t ck) {
+    xcb_generic_error_t *e = NULL;
+    xcb_get_property_reply_t *r = xcb_get_property_reply(xcon, ck, &e);
+
+    free(e);
+
+    if (r && r -> type == XCB_NONE) {
+        free(r);
+        r = NULL;
+    }
+
+    return r;
+}
+
+
+Atom atomreply(xcb_get_property_reply_t *r) {
+    if (!r || r -> format != 32 || !r -> value_len) { return None; }
+
+    return *(xcb_atom_t *)xcb_get_property_value(r);
+}
+
+
+Window windowreply(xcb_get_property_reply_t *r) {
+    if (!r || r -> format != 32 || !r -> value_len) { return None; }
+
+    return *(xcb_window_t *)xcb_get_property_value(r);
+}
+
+
+unsigned long cardinalreply(xcb_get_property_reply_t *r) {
+    if (!r || r -> format != 32 || !r -> value_len) { return 0; }
+
+    return *(uint32_t *)xcb_get_property_value(r);
+}
+
+
+int atomsreplyhas(xcb_get_property_reply_t *r, Atom atom) {
+    xcb_atom_t *a;
+    uint32_t i;
+
+    if (!r || r -> format != 32) { return 0; }
+
+    a = xcb_get_property_value(r);
+
+    for (i = 0; i < r -> value_len; i++) {
+        if (a[i] == atom) { return 1; }
+    }
+
+    return 0;
+}
+
+
+int textreply(xcb_get_property_reply_t *r, char *text, unsigned int size) {
+    XTextProperty name;
+
+    text[0] = '\0';
+
+    if (!r) { return 0; }
+
+    name.value = xcb_get_property_value(r);
+    name.encoding = r -> type;
+    name.format = r -> format;
+    name.nitems = r -> value_len;
+
+    return textprop(&name, text, size);
+}
+
+
+/* decode WM_NORMAL_HINTS the way XGetWMNormalHints() does */
+int sizehintsreply(xcb_get_property_reply_t *r, XSizeHints *size) {
+    int32_t *v;
+
+    if (!r || r -> format != 32 || r -> value_len < 15) { return 0; }
+
+    v = xcb_get_property_value(r);
+
+    size -> flags = (uint32_t)v[0];
+    size -> min_width = v[5];
+    size -> min_height = v[6];
+    size -> max_width = v[7];
+    size -> max_height = v[8];
+    size -> width_inc = v[9];
+    size -> height_inc = v[10];
+    size -> min_aspect.x = v[11];
+    size -> min_aspect.y = v[12];
+    size -> max_aspect.x = v[13];
+    size -> max_aspect.y = v[14];
+
+    if (r -> value_len >= 18) {
+        size -> base_width = v[15];
+        size -> base_height = v[16];
+        size -> win_gravity = v[17];
+    } else {
+        size -> flags &= ~(PBaseSize|PWinGravity);
+    }
+
+    return 1;
+}
+
+
+/* decode WM_HINTS the way XGetWMHints() does */
+int wmhintsreply(xcb_get_property_reply_t *r, XWMHints *wmh) {
+    uint32_t *v;
+
+    if (!r || r -> format != 32 || r -> value_len < 8) { return 0; }
+
+    v = xcb_get_property_value(r);
+
+    wmh -> flags = v[0];
+    wmh -> input = v[1];
+    wmh -> initial_state = v[2];
+    wmh -> icon_pixmap = v[3];
+    wmh -> icon_window = v[4];
+    wmh -> icon_x = v[5];
+    wmh -> icon_y = v[6];
+    wmh -> icon_mask = v[7];
+    wmh -> window_group = r -> value_len >= 9 ? v[8] : 0;
+
+    return 1;
+}
+
+
 pid_t getparentprocess(pid_t p) {
     unsigned int v = 0;
 
@@ -3549,6 +5304,55 @@ pid_t getparentprocess(pid_t p) {
 }
 
 
+/* c can be frozen without stopping a process that backs a visible or
+ * unrelated window */
+int canfreeze(const Client *c) {
+    Client *t;
+    Monitor *m;
+
+    if (!c -> pid || c -> pid == getpid() || c -> swallowing) { return 0; }
+
+    for (m = mons; m; m = m -> next) {
+        for (t = m -> clients; t; t = t -> next) {
+            if (t == c || !t -> pid) { continue; }
+
+            if (t -> pid == c -> pid ? ISVISIBLE(t) : isdescprocess(c -> pid, t -> pid)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+/* one of the bar, tab bar and input windows dynamd keeps per monitor */
+int ismonwin(Window w) {
+    Monitor *m;
+
+    for (m = mons; m; m = m -> next) {
+        if (w == m -> barwin || w == m -> tabwin || w == m -> inputwin) { return 1; }
+    }
+
+    return 0;
+}
+
+
+/* another client backed by the process of c */
+Client *pidsibling(const Client *c) {
+    Client *t;
+    Monitor *m;
+
+    for (m = mons; m; m = m -> next) {
+        for (t = m -> clients; t; t = t -> next) {
+            if (t != c && t -> pid == c -> pid) { return t; }
+        }
+    }
+
+    return NULL;
+}
+
+
 int isdescprocess(pid_t p, pid_t c) {
     while (p != c && c != 0) {
         c = getparentprocess(c);
@@ -3579,6 +5383,40 @@ Client *termforwin(const Client *w) {
 }
 
 
+/* exchange the windows of a and b together with the state tied to them */
+void swapwindows(Client *a, Client *b) {
+    Client t = *a;
+
+    a -> win = b -> win;
+    a -> curbw = b -> curbw;
+    a -> isiconic = b -> isiconic;
+    a -> iscovered = b -> iscovered;
+    a -> ignoreunmap = b -> ignoreunmap;
+    a -> grabstate = b -> grabstate;
+    a -> cfgreq = b -> cfgreq;
+    a -> cfgpending = b -> cfgpending;
+    a -> pending = b -> pending;
+    a -> canping = b -> canping;
+    a -> isunresponsive = b -> isunresponsive;
+    a -> pingsent = b -> pingsent;
+    a -> pingms = b -> pingms;
+
+    b -> win = t.win;
+    b -> curbw = t.curbw;
+    b -> isiconic = t.isiconic;
+    b -> iscovered = t.iscovered;
+    b -> ignoreunmap = t.ignoreunmap;
+    b -> grabstate = t.grabstate;
+    b -> cfgreq = t.cfgreq;
+    b -> cfgpending = t.cfgpending;
+    b -> pending = t.pending;
+    b -> canping = t.canping;
+    b -> isunresponsive = t.isunresponsive;
+    b -> pingsent = t.pingsent;
+    b -> pingms = t.pingms;
+}
+
+
 Client *swallowingclient(Window w) {
     Client *c;
     Monitor *m;
@@ -3616,12 +5454,12 @@ Monitor *wintomon(Window w) {
     Client *c;
     Monitor *m;
 
-    if (w == root && getrootptr(&x, &y)) {
+    if (w == root && getptr(&x, &y)) {
         return recttomon(x, y, 1, 1);
     }
 
     for (m = mons; m; m = m -> next) {
-        if (w == m -> barwin || w == m -> tabwin) {
+        if (w == m -> barwin || w == m -> tabwin || w == m -> inputwin) {
             return m;
         }
     }
@@ -3634,6 +5472,24 @@ Monitor *wintomon(Window w) {
 }
 
 
+/* write value to a control file in pid's cgroup, see getcgroup() */
+int writecgroup(pid_t pid, const char *file, const char *value, int dedicated) {
+    char path[PATH_MAX], buf[PATH_MAX];
+    FILE *f;
+    int ok;
+
+    if (!getcgroup(pid, path, sizeof path, dedicated)) { return 0; }
+
+    if ((size_t)snprintf(buf, sizeof buf, "%s/%s", path, file) >= sizeof buf) { return 0; }
+
+    if (!(f = fopen(buf, "w"))) { return 0; }
+
+    ok = fputs(value, f) >= 0;
+
+    return !fclose(f) && ok;
+}
+
+
 /* There's no way to check accesses to destroyed windows, thus those cases are
  * ignored (especially on UnmapNotify's). Other types of errors call Xlibs
  * default error handler, which may call exit. */
@@ -3685,6 +5541,9 @@ void zoom(const Arg *arg) {
 }
 
 int main(int argc, char *argv[]) {
+    /* the bars are drawn by a second thread on its own connection */
+    XInitThreads();
+
     if (!setlocale(LC_CTYPE, "") || !XSupportsLocale()) {
         fputs("warning: no locale support\n", stderr);
     }
@@ -59,6 +59,13 @@ void *ecalloc(size_t nmemb, size_t size) {
 }
 
 
+void *erealloc(void *p, size_t size) {
+    if (!(p = realloc(p, size))) { die("realloc:"); }
+
+    return p;
+}
+
+
 void die(const char *fmt, ...) {
     va_list ap;
 
@@ -48,3 +48,4 @@ DEALINGS IN THE SOFTWARE.
 
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
+void *erealloc(void *p, size_t size);